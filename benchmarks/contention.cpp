@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MRHelper/ThreadPool.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* modeName(mrh::ThreadPool::Mode mode) {
+    return mode == mrh::ThreadPool::Mode::SharedQueue ? "shared-queue" : "work-stealing";
+}
+
+template <typename T>
+void waitHelping(std::future<T>& fut, mrh::ThreadPool& pool) {
+    while (fut.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready) {
+        if (!pool.tryExecuteOne())
+            std::this_thread::yield();
+    }
+}
+
+/// External threads flood the pool with tiny tasks.
+double externalFlood(mrh::ThreadPool::Mode mode, size_t numThreads, size_t numTasks) {
+    mrh::ThreadPool pool(numThreads, mode);
+    std::atomic<size_t> done{0};
+    const auto start = Clock::now();
+    std::vector<std::future<void>> futures;
+    futures.reserve(numTasks);
+    for (size_t i = 0; i < numTasks; ++i)
+        futures.push_back(pool.enqueue([&done] { done.fetch_add(1, std::memory_order_relaxed); }));
+    for (auto& fut : futures)
+        fut.wait();
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/// Tasks fan out children from inside the pool, as MapReduceTask does.
+double nestedFanOut(mrh::ThreadPool::Mode mode, size_t numThreads, size_t numParents, size_t numChildren) {
+    mrh::ThreadPool pool(numThreads, mode);
+    std::atomic<size_t> done{0};
+    const auto start = Clock::now();
+    std::vector<std::future<void>> parents;
+    for (size_t i = 0; i < numParents; ++i) {
+        parents.push_back(pool.enqueue([&pool, &done, numChildren] {
+            std::vector<std::future<void>> children;
+            children.reserve(numChildren);
+            for (size_t c = 0; c < numChildren; ++c)
+                children.push_back(pool.enqueue([&done] { done.fetch_add(1, std::memory_order_relaxed); }));
+            for (auto& child : children)
+                waitHelping(child, pool);
+        }));
+    }
+    for (auto& parent : parents)
+        parent.wait();
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const size_t numTasks = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    const size_t maxThreads = std::max(2u, std::thread::hardware_concurrency());
+
+    std::cout << "benchmark,mode,threads,tasks,ms" << std::endl;
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        for (auto mode : {mrh::ThreadPool::Mode::SharedQueue, mrh::ThreadPool::Mode::WorkStealing}) {
+            std::cout << "external-flood," << modeName(mode) << ',' << threads << ',' << numTasks << ','
+                      << externalFlood(mode, threads, numTasks) << std::endl;
+            std::cout << "nested-fan-out," << modeName(mode) << ',' << threads << ',' << numTasks << ','
+                      << nestedFanOut(mode, threads, threads * 2, numTasks / (threads * 2)) << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <any>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "MRHelper/MapReduceTask.hpp"
+#include "MRHelper/SimpleTask.hpp"
+#include "MRHelper/ThreadPool.hpp"
+
+namespace {
+
+using Clock    = std::chrono::steady_clock;
+using Input    = std::vector<uint64_t>;
+using Splitter = mrh::RangeSplitter<Input>;
+using Task     = mrh::MapReduceTask<Input, uint64_t, uint64_t, uint64_t, Splitter>;
+
+const char* strategyName(mrh::ShuffleStrategy strategy) {
+    return strategy == mrh::ShuffleStrategy::Hash ? "hash" : "sort";
+}
+
+/// Runs a sum-by-key job over the input and returns the best of a few wall times.
+double sumByKey(mrh::ThreadPool& pool, const std::shared_ptr<mrh::Task>& source, mrh::ShuffleStrategy strategy,
+                uint64_t cardinality) {
+    auto mapFunc = [cardinality](const Splitter::Shard& shard) {
+        std::vector<std::pair<uint64_t, uint64_t>> out;
+        out.reserve(shard.size());
+        for (uint64_t x : shard)
+            out.emplace_back(x % cardinality, x);
+        return out;
+    };
+    auto reduceFunc = [](const uint64_t&, const std::vector<uint64_t>& values) {
+        uint64_t sum = 0;
+        for (uint64_t v : values)
+            sum += v;
+        return sum;
+    };
+
+    double best = 0;
+    for (int rep = 0; rep < 3; ++rep) {
+        auto task = std::make_shared<Task>(mapFunc, reduceFunc, static_cast<int>(pool.getNumThreads()), false);
+        task->dependsOn(source);
+        task->setShuffleStrategy(strategy);
+        const auto start = Clock::now();
+        task->execute(pool);
+        const double took = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        best              = rep == 0 ? took : std::min(best, took);
+    }
+    return best;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const size_t numPairs = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+    mrh::ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+
+    // Scrambled input so that neither strategy sees pre-sorted keys.
+    auto source = std::make_shared<mrh::SimpleTask>([numPairs](const std::vector<std::any>&) -> std::any {
+        Input data(numPairs);
+        uint64_t x = 88172645463325252ULL;
+        for (auto& v : data) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            v = x;
+        }
+        return data;
+    });
+    source->execute(pool);
+
+    std::cout << "strategy,pairs,cardinality,ms" << std::endl;
+    for (uint64_t cardinality : {16ULL, 1024ULL, 65536ULL, 1048576ULL}) {
+        for (auto strategy : {mrh::ShuffleStrategy::Hash, mrh::ShuffleStrategy::Sort}) {
+            std::cout << strategyName(strategy) << ',' << numPairs << ',' << cardinality << ','
+                      << sumByKey(pool, source, strategy, cardinality) << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "MRHelper/ThreadPool.hpp"
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+
+using Clock = std::chrono::steady_clock;
+
+struct Sample {
+    double nsPerTask;
+    double allocationsPerTask;
+};
+
+/// Measures submitting and completing numTasks tasks with the given submit function.
+template <typename Submit>
+Sample measure(size_t numTasks, Submit&& submit) {
+    const size_t before = allocations.load();
+    const auto start    = Clock::now();
+    submit(numTasks);
+    const auto took = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    return {took / numTasks, static_cast<double>(allocations.load() - before) / numTasks};
+}
+
+void report(const char* path, const Sample& sample) {
+    std::cout << path << ',' << sample.nsPerTask << ',' << sample.allocationsPerTask << std::endl;
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+// GCC pairs the free() below with the new-expressions it inlines this file's operator new
+// into and reports a mismatch, although both sides are the malloc-based replacements.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+int main(int argc, char** argv) {
+    const size_t numTasks = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    mrh::ThreadPool pool(1);
+    std::atomic<size_t> done{0};
+    auto work = [&done] { done.fetch_add(1, std::memory_order_relaxed); };
+
+    // Tasks are submitted in windows and awaited before the next window, as the
+    // MapReduce phases do; this keeps the number of live futures bounded.
+    const size_t window = 128;
+    std::vector<std::future<void>> futures;
+    futures.reserve(window);
+
+    std::cout << "path,ns_per_task,allocations_per_task" << std::endl;
+
+    // Previous submission path: std::bind + shared packaged_task + std::function.
+    report("packaged_task", measure(numTasks, [&](size_t n) {
+               for (size_t i = 0; i < n; i += window) {
+                   futures.clear();
+                   for (size_t j = 0; j < window; ++j) {
+                       auto task = std::make_shared<std::packaged_task<void()>>(std::bind(work));
+                       futures.push_back(task->get_future());
+                       pool.post(std::function<void()>([task]() { (*task)(); }));
+                   }
+                   for (auto& fut : futures)
+                       fut.get();
+               }
+           }));
+
+    report("enqueue", measure(numTasks, [&](size_t n) {
+               for (size_t i = 0; i < n; i += window) {
+                   futures.clear();
+                   for (size_t j = 0; j < window; ++j)
+                       futures.push_back(pool.enqueue(work));
+                   for (auto& fut : futures)
+                       fut.get();
+               }
+           }));
+
+    report("enqueueBatch", measure(numTasks, [&](size_t n) {
+               std::vector<decltype(work)> batch(window, work);
+               for (size_t i = 0; i < n; i += batch.size()) {
+                   for (auto& fut : pool.enqueueBatch(batch.begin(), batch.end()))
+                       fut.get();
+               }
+           }));
+
+    report("post", measure(numTasks, [&](size_t n) {
+               for (size_t i = 0; i < n; i += window) {
+                   const size_t target = done.load() + window;
+                   for (size_t j = 0; j < window; ++j)
+                       pool.post(work);
+                   while (done.load() < target)
+                       pool.tryExecuteOne();
+               }
+           }));
+    return 0;
+}
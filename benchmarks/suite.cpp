@@ -0,0 +1,439 @@
+#include <algorithm>
+#include <any>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "MRHelper/MapReduceTask.hpp"
+#include "MRHelper/Scheduler.hpp"
+#include "MRHelper/SimpleTask.hpp"
+#include "MRHelper/ThreadPool.hpp"
+#include "MRHelper/TypedTask.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Command line options.
+struct Options {
+    bool quick         = false;  ///< Smaller inputs and fewer repetitions, for smoke runs.
+    size_t repetitions = 0;      ///< Samples per case; 0 uses the default of each group.
+    std::string filter;          ///< Only cases whose name contains this string run.
+};
+
+/// Numeric parameter of a case, reported alongside its statistics.
+struct Param {
+    template <typename T>
+    Param(const char* name, T value) : name(name), value(static_cast<double>(value)) {}
+
+    const char* name;  ///< Name of the parameter.
+    double value;      ///< Value of the parameter.
+};
+
+/**
+ * @brief Collects the cases of a run and prints them as one JSON document.
+ *
+ * Every case is run once untimed to warm up, then sampled a number of times.
+ * A sample is the time of one call divided by the number of operations it
+ * performed, so cases of different sizes report comparable per-operation
+ * costs.
+ */
+class Suite {
+public:
+    explicit Suite(Options options) : _options(std::move(options)) {}
+
+    /**
+     * @brief Runs and records a case.
+     *
+     * @param name Name of the case, such as "scheduler/chain".
+     * @param params Parameters of the case.
+     * @param numOps Number of operations performed by one call of body.
+     * @param repetitions Default number of samples.
+     * @param body Performs the operations; setup returns before the clock starts.
+     * @param setup Runs before every call of body, untimed.
+     */
+    void run(const std::string& name, std::vector<Param> params, size_t numOps, size_t repetitions,
+             const std::function<void()>& body, const std::function<void()>& setup = {}) {
+        if (name.find(_options.filter) == std::string::npos)
+            return;
+        if (_options.repetitions)
+            repetitions = _options.repetitions;
+        else if (_options.quick)
+            repetitions = std::min<size_t>(repetitions, 3);
+
+        std::vector<double> samples;
+        for (size_t rep = 0; rep <= repetitions; ++rep) {
+            if (setup)
+                setup();
+            const auto start = Clock::now();
+            body();
+            const double took = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            if (rep > 0)
+                samples.push_back(took / static_cast<double>(numOps));
+        }
+        std::sort(samples.begin(), samples.end());
+        double sum = 0;
+        for (double s : samples)
+            sum += s;
+
+        std::string json = "    {\"name\": \"" + name + "\", \"params\": {";
+        for (size_t i = 0; i < params.size(); ++i)
+            json += (i ? ", \"" : "\"") + std::string(params[i].name) + "\": " + number(params[i].value);
+        json += "}, \"unit\": \"ns_per_op\", \"ops\": " + std::to_string(numOps);
+        json += ", \"samples\": " + std::to_string(samples.size());
+        json += ", \"min\": " + number(samples.front()) + ", \"p50\": " + number(percentile(samples, 50));
+        json += ", \"p90\": " + number(percentile(samples, 90)) + ", \"p99\": " + number(percentile(samples, 99));
+        json += ", \"max\": " + number(samples.back()) + ", \"mean\": " + number(sum / samples.size()) + "}";
+        _entries.push_back(std::move(json));
+        std::cerr << name << " done" << std::endl;
+    }
+
+    /// Prints the recorded cases.
+    void print(std::ostream& out) const {
+        out << "{\n  \"suite\": \"MRHelper\",\n  \"hardware_concurrency\": " << std::thread::hardware_concurrency()
+            << ",\n  \"quick\": " << (_options.quick ? "true" : "false") << ",\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < _entries.size(); ++i)
+            out << _entries[i] << (i + 1 < _entries.size() ? ",\n" : "\n");
+        out << "  ]\n}" << std::endl;
+    }
+
+    /// Scales a size down for quick runs.
+    size_t scaled(size_t size) const { return _options.quick ? std::max<size_t>(1, size / 10) : size; }
+
+private:
+    /// Nearest-rank percentile of sorted samples.
+    static double percentile(const std::vector<double>& sorted, double p) {
+        const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+        return sorted[std::min(sorted.size() - 1, rank ? rank - 1 : 0)];
+    }
+
+    static std::string number(double value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+        return buffer;
+    }
+
+    Options _options;                   ///< Command line options.
+    std::vector<std::string> _entries;  ///< JSON objects of the recorded cases.
+};
+
+/// Thread counts from 1 up to at least 2 and the hardware concurrency, doubling.
+std::vector<size_t> threadCounts() {
+    std::vector<size_t> counts;
+    const size_t maxThreads = std::max(2u, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2)
+        counts.push_back(threads);
+    return counts;
+}
+
+/**
+ * @brief Draws values from a Zipf distribution over [0, n).
+ *
+ * A skew of 0 is uniform; larger skews concentrate the draws on few values.
+ */
+class Zipf {
+public:
+    Zipf(size_t n, double skew) : _cdf(n) {
+        double total = 0;
+        for (size_t i = 0; i < n; ++i)
+            _cdf[i] = total += 1.0 / std::pow(static_cast<double>(i + 1), skew);
+        for (double& c : _cdf)
+            c /= total;
+    }
+
+    template <typename Rng>
+    size_t operator()(Rng& rng) {
+        const double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        return std::min<size_t>(std::lower_bound(_cdf.begin(), _cdf.end(), u) - _cdf.begin(), _cdf.size() - 1);
+    }
+
+private:
+    std::vector<double> _cdf;  ///< Cumulative probabilities.
+};
+
+void benchmarkThreadPool(Suite& suite) {
+    const size_t numTasks = suite.scaled(100000);
+    for (size_t threads : threadCounts()) {
+        mrh::ThreadPool pool(threads);
+        std::atomic<size_t> done{0};
+        auto work = [&done] { done.fetch_add(1, std::memory_order_relaxed); };
+        std::vector<std::future<void>> futures;
+        futures.reserve(numTasks);
+
+        // Every task is submitted from outside the pool and awaited through its future.
+        suite.run("threadpool/enqueue", {{"threads", threads}, {"tasks", numTasks}}, numTasks, 10, [&] {
+            futures.clear();
+            for (size_t i = 0; i < numTasks; ++i)
+                futures.push_back(pool.enqueue(work));
+            for (auto& fut : futures)
+                fut.wait();
+        });
+
+        // Fire-and-forget submission; the caller helps until all tasks have run.
+        suite.run("threadpool/post", {{"threads", threads}, {"tasks", numTasks}}, numTasks, 10, [&] {
+            const size_t target = done.load() + numTasks;
+            for (size_t i = 0; i < numTasks; ++i)
+                pool.post(work);
+            while (done.load() < target) {
+                if (!pool.tryExecuteOne())
+                    std::this_thread::yield();
+            }
+        });
+    }
+}
+
+/// A graph whose sources are invalidated before every execution, so all of its tasks run.
+struct Graph {
+    std::shared_ptr<mrh::Task> root;                  ///< Root of the graph.
+    std::vector<std::shared_ptr<mrh::Task>> sources;  ///< Tasks without dependencies.
+    size_t numTasks = 0;                              ///< Number of tasks.
+};
+
+std::shared_ptr<mrh::Task> makeNode() {
+    return std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>& inputs) -> std::any {
+        return static_cast<int>(inputs.size());
+    });
+}
+
+/// A chain of n tasks, each depending on the previous one.
+Graph makeChain(size_t n) {
+    Graph graph;
+    graph.sources.push_back(makeNode());
+    graph.root = graph.sources.front();
+    for (size_t i = 1; i < n; ++i) {
+        auto next = makeNode();
+        next->dependsOn(graph.root);
+        graph.root = next;
+    }
+    graph.numTasks = n;
+    return graph;
+}
+
+/// One root depending on n - 1 independent sources.
+Graph makeWide(size_t n) {
+    Graph graph;
+    graph.root = makeNode();
+    for (size_t i = 1; i < n; ++i) {
+        graph.sources.push_back(makeNode());
+        graph.root->dependsOn(graph.sources.back());
+    }
+    graph.numTasks = n;
+    return graph;
+}
+
+/// One source fanning out to n - 2 tasks that all feed one root.
+Graph makeDiamond(size_t n) {
+    Graph graph;
+    graph.sources.push_back(makeNode());
+    graph.root = makeNode();
+    for (size_t i = 2; i < n; ++i) {
+        auto middle = makeNode();
+        middle->dependsOn(graph.sources.front());
+        graph.root->dependsOn(middle);
+    }
+    graph.numTasks = n;
+    return graph;
+}
+
+void benchmarkScheduler(Suite& suite) {
+    const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    mrh::Scheduler scheduler(threads);
+    const std::pair<const char*, Graph (*)(size_t)> shapes[] = {
+        {"scheduler/chain", makeChain}, {"scheduler/wide", makeWide}, {"scheduler/diamond", makeDiamond}};
+    for (const auto& [name, make] : shapes) {
+        for (size_t size : {16, 256, 4096}) {
+            Graph graph = make(std::max<size_t>(4, suite.scaled(size)));
+            auto plan   = mrh::Scheduler::compile(graph.root);
+            auto reset  = [&graph] {
+                for (const auto& source : graph.sources)
+                    source->invalidate();
+            };
+            suite.run(name, {{"threads", threads}, {"tasks", graph.numTasks}}, graph.numTasks, 20,
+                      [&] { scheduler.execute(*plan); }, reset);
+        }
+    }
+}
+
+/// Busy-waits, so that a task occupies its thread like real work.
+void spinFor(std::chrono::microseconds duration) {
+    const auto end = Clock::now() + duration;
+    while (Clock::now() < end) {
+    }
+}
+
+/**
+ * @brief Makespan of an unbalanced graph with a known critical path.
+ *
+ * A chain of 20 tasks of 250 us each is the critical path (5 ms). It starts in
+ * the middle of 8 independent 500 us leaves per thread, so neither taking the
+ * oldest nor the newest ready task reaches it early. One op is one execution.
+ */
+void benchmarkCriticalPath(Suite& suite) {
+    const size_t threads = std::max(2u, std::thread::hardware_concurrency());
+    auto spinning        = [](std::chrono::microseconds duration) {
+        return std::make_shared<mrh::SimpleTask>([duration](const std::vector<std::any>&) -> std::any {
+            spinFor(duration);
+            return 0;
+        });
+    };
+    auto root = spinning(std::chrono::microseconds(0));
+    std::vector<std::shared_ptr<mrh::Task>> sources;
+    const size_t numLeaves = 8 * threads;
+    for (size_t i = 0; i < numLeaves; ++i) {
+        if (i == numLeaves / 2) {
+            sources.push_back(spinning(std::chrono::microseconds(250)));
+            std::shared_ptr<mrh::Task> chain = sources.back();
+            for (int link = 1; link < 20; ++link) {
+                auto next = spinning(std::chrono::microseconds(250));
+                next->dependsOn(chain);
+                chain = next;
+            }
+            root->dependsOn(chain);
+        }
+        sources.push_back(spinning(std::chrono::microseconds(500)));
+        root->dependsOn(sources.back());
+    }
+
+    mrh::Scheduler scheduler(threads);
+    auto plan  = mrh::Scheduler::compile(root);
+    auto reset = [&sources] {
+        for (const auto& source : sources)
+            source->invalidate();
+    };
+    const std::pair<const char*, mrh::Scheduler::Policy> policies[] = {
+        {"scheduler/unbalanced-fifo", mrh::Scheduler::Policy::Fifo},
+        {"scheduler/unbalanced-critical-path", mrh::Scheduler::Policy::CriticalPath}};
+    for (const auto& [name, policy] : policies) {
+        scheduler.setPolicy(policy);
+        suite.run(name, {{"threads", threads}, {"tasks", plan->size()}, {"critical_path_us", 5000}}, 1, 20,
+                  [&] { scheduler.execute(*plan); }, reset);
+    }
+}
+
+using WordCount = mrh::MapReduceTask<std::string, std::string, int, int, mrh::DelimitedSplitter<std::string>>;
+using Aggregate = mrh::MapReduceTask<std::vector<uint64_t>, uint64_t, uint64_t, uint64_t,
+                                     mrh::RangeSplitter<std::vector<uint64_t>>>;
+
+void benchmarkWordCount(Suite& suite, mrh::ThreadPool& pool, size_t numWords, double skew) {
+    auto source = std::make_shared<mrh::TypedTask<std::string>>([numWords, skew](const mrh::TaskInputs&) {
+        std::mt19937_64 rng(42);
+        Zipf zipf(50000, skew);
+        std::string text;
+        for (size_t i = 0; i < numWords; ++i) {
+            text += 'w';
+            text += std::to_string(zipf(rng));
+            text += i % 16 == 15 ? '\n' : ' ';
+        }
+        return text;
+    });
+    source->execute(pool);
+
+    auto mapFunc = [](const std::string_view& shard) {
+        std::vector<std::pair<std::string, int>> out;
+        size_t begin = 0;
+        while (begin < shard.size()) {
+            size_t end = shard.find_first_of(" \n", begin);
+            if (end == std::string_view::npos)
+                end = shard.size();
+            if (end > begin)
+                out.emplace_back(std::string(shard.substr(begin, end - begin)), 1);
+            begin = end + 1;
+        }
+        return out;
+    };
+    auto reduceFunc = [](const std::string&, const std::vector<int>& values) {
+        return static_cast<int>(values.size());
+    };
+    auto task = std::make_shared<WordCount>(mapFunc, reduceFunc, static_cast<int>(pool.getNumThreads()), false);
+    task->dependsOn(source);
+    suite.run("mapreduce/word-count",
+              {{"threads", pool.getNumThreads()}, {"words", numWords}, {"skew", skew}}, numWords, 5,
+              [&] { task->execute(pool); });
+}
+
+void benchmarkAggregate(Suite& suite, mrh::ThreadPool& pool, size_t numRecords, double skew) {
+    auto source = std::make_shared<mrh::TypedTask<std::vector<uint64_t>>>([numRecords, skew](const mrh::TaskInputs&) {
+        std::mt19937_64 rng(7);
+        Zipf zipf(100000, skew);
+        std::vector<uint64_t> keys(numRecords);
+        for (auto& key : keys)
+            key = zipf(rng);
+        return keys;
+    });
+    source->execute(pool);
+
+    auto mapFunc = [](const mrh::RangeSplitter<std::vector<uint64_t>>::Shard& shard) {
+        std::vector<std::pair<uint64_t, uint64_t>> out;
+        out.reserve(shard.size());
+        for (uint64_t key : shard)
+            out.emplace_back(key, key * 2654435761ULL % 1000);
+        return out;
+    };
+    auto reduceFunc = [](const uint64_t&, const std::vector<uint64_t>& values) {
+        uint64_t sum = 0;
+        for (uint64_t v : values)
+            sum += v;
+        return sum;
+    };
+    auto task = std::make_shared<Aggregate>(mapFunc, reduceFunc, static_cast<int>(pool.getNumThreads()), false);
+    task->dependsOn(source);
+    suite.run("mapreduce/aggregate",
+              {{"threads", pool.getNumThreads()}, {"records", numRecords}, {"skew", skew}}, numRecords, 5,
+              [&] { task->execute(pool); });
+}
+
+void benchmarkMapReduce(Suite& suite) {
+    mrh::ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    for (size_t size : {100000, 1000000}) {
+        for (double skew : {0.0, 1.2}) {
+            benchmarkWordCount(suite, pool, suite.scaled(size), skew);
+            benchmarkAggregate(suite, pool, suite.scaled(size), skew);
+        }
+    }
+}
+
+}  // namespace
+
+/**
+ * Usage: MRHelperBenchmarkSuite [--quick] [--repetitions N] [--filter NAME]
+ *
+ * Prints one JSON document with per-operation percentiles of every case to
+ * stdout; progress goes to stderr.
+ */
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quick") == 0) {
+            options.quick = true;
+        } else if (std::strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) {
+            options.repetitions = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--quick] [--repetitions N] [--filter NAME]" << std::endl;
+            return 1;
+        }
+    }
+
+    Suite suite(options);
+    benchmarkThreadPool(suite);
+    benchmarkScheduler(suite);
+    benchmarkCriticalPath(suite);
+    benchmarkMapReduce(suite);
+    suite.print(std::cout);
+    return 0;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace mrh {
+
+/**
+ * @brief Thrown when work is abandoned because its CancellationToken was cancelled or its deadline passed.
+ */
+class OperationCancelled: public std::runtime_error {
+public:
+    OperationCancelled() : std::runtime_error("operation cancelled") {}
+};
+
+/**
+ * @brief Shared flag and deadline for cooperatively cancelling a graph of work.
+ *
+ * Copies of a token share their state. Cancellation is cooperative: the
+ * library checks the token before starting a task (Task::execute()), before
+ * running each child of a TaskGroup, and thereby before every map, shuffle and
+ * reduce chunk of a MapReduceTask. Children that have been queued on the pool
+ * but not started are dropped when they are dequeued, so an abandoned graph
+ * frees its threads as soon as their current chunks end.
+ *
+ * Work finds its token through CancellationToken::current(), which TaskGroup
+ * and Scheduler install on every thread that runs a child.
+ */
+class CancellationToken {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// Constructs a token that is never cancelled.
+    CancellationToken() = default;
+
+    /// Returns a new token that is cancelled by cancel().
+    static CancellationToken create();
+
+    /**
+     * @brief Returns a new token that is cancelled by cancel() or once the deadline has passed.
+     * @param deadline The deadline.
+     */
+    static CancellationToken withDeadline(Clock::time_point deadline);
+
+    /**
+     * @brief Returns a new token that is cancelled by cancel() or once the timeout has elapsed.
+     * @param timeout Time from now until the deadline.
+     */
+    static CancellationToken withTimeout(Clock::duration timeout);
+
+    /**
+     * @brief Returns a new token that is also cancelled when this token is.
+     *
+     * Cancelling the child does not cancel this token.
+     */
+    CancellationToken child() const;
+
+    /// Cancels the token and every child; has no effect on a token that can never be cancelled.
+    void cancel() const;
+
+    /// Returns true if the token has been cancelled or its deadline has passed.
+    bool isCancelled() const;
+
+    /**
+     * @brief Throws if the token has been cancelled or its deadline has passed.
+     * @throws OperationCancelled If so.
+     */
+    void throwIfCancelled() const {
+        if (isCancelled())
+            throw OperationCancelled();
+    }
+
+    /// Returns the deadline, or Clock::time_point::max() if there is none.
+    Clock::time_point getDeadline() const;
+
+    /// Returns false for tokens that can never be cancelled.
+    bool canBeCancelled() const { return static_cast<bool>(_state); }
+
+    /**
+     * @brief Returns the token of the work running on the calling thread.
+     * @return The token installed by the innermost CancellationScope, or a token that is never cancelled.
+     */
+    static const CancellationToken& current();
+
+private:
+    struct State {
+        std::atomic<bool> cancelled{false};                     ///< Set by cancel().
+        Clock::time_point deadline = Clock::time_point::max();  ///< Earliest deadline of this and all parents.
+        std::shared_ptr<const State> parent;                    ///< Token this one was derived from.
+    };
+
+    explicit CancellationToken(std::shared_ptr<State> state) : _state(std::move(state)) {}
+
+    std::shared_ptr<State> _state;  ///< Shared state, null for tokens that are never cancelled.
+};
+
+/**
+ * @brief Makes a token the current token of the calling thread for the lifetime of the scope.
+ *
+ * The token must outlive the scope.
+ */
+class CancellationScope {
+public:
+    explicit CancellationScope(const CancellationToken& token);
+    ~CancellationScope();
+
+    CancellationScope(const CancellationScope&)            = delete;
+    CancellationScope& operator=(const CancellationScope&) = delete;
+
+private:
+    const CancellationToken* _previous;  ///< Token to restore.
+};
+
+}  // namespace mrh
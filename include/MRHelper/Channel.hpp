@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace mrh {
+
+/**
+ * @brief A message exchanged between a coordinator and a worker process.
+ *
+ * On the wire a frame is a 17-byte header (type, then id and payload size as
+ * little-endian 64-bit integers) followed by the payload. Payloads hold
+ * values written with Serializer, so both ends must share its native byte
+ * order.
+ */
+struct Frame {
+    /// Kind of a frame.
+    enum class Type : uint8_t {
+        Request = 1,  ///< Work for a worker; the payload is the request.
+        Reply   = 2,  ///< Successful result of a request with the same id.
+        Error   = 3,  ///< A request failed; the payload is the error message.
+    };
+
+    Type type   = Type::Request;  ///< Kind of the frame.
+    uint64_t id = 0;              ///< Identifies the request a reply belongs to.
+    std::string payload;          ///< Opaque message body.
+};
+
+/**
+ * @brief A bidirectional, ordered stream of frames.
+ *
+ * The executor only talks to its workers through this interface, so the
+ * transport can be replaced without touching the protocol.
+ */
+class Channel {
+public:
+    virtual ~Channel() = default;
+
+    /**
+     * @brief Sends a frame.
+     * @param frame The frame.
+     * @throws std::system_error If the peer has gone away or the transport fails.
+     */
+    virtual void send(const Frame& frame) = 0;
+
+    /**
+     * @brief Receives the next frame, blocking until it has arrived completely.
+     * @param frame Receives the frame.
+     * @return False if the peer closed the channel or died.
+     */
+    virtual bool receive(Frame& frame) = 0;
+};
+
+/**
+ * @brief A Channel over a connected stream socket, such as a Unix-domain or TCP socket.
+ *
+ * Only available on POSIX systems; elsewhere every operation throws std::logic_error.
+ */
+class SocketChannel: public Channel {
+public:
+    /**
+     * @brief Takes ownership of a connected socket.
+     * @param socket The socket descriptor.
+     */
+    explicit SocketChannel(int socket);
+
+    /// Closes the socket.
+    ~SocketChannel() override;
+
+    SocketChannel(SocketChannel&& other) noexcept : _socket(std::exchange(other._socket, -1)) {}
+    SocketChannel& operator=(SocketChannel&& other) noexcept;
+    SocketChannel(const SocketChannel&)            = delete;
+    SocketChannel& operator=(const SocketChannel&) = delete;
+
+    /**
+     * @brief Creates two channels connected to each other by a Unix-domain socket pair.
+     * @return The two ends.
+     * @throws std::system_error If the sockets cannot be created.
+     */
+    static std::pair<SocketChannel, SocketChannel> createPair();
+
+    void send(const Frame& frame) override;
+    bool receive(Frame& frame) override;
+
+    /// Closes the socket; the peer then sees the end of the channel.
+    void close();
+
+    /// Returns the socket descriptor, or -1 once closed.
+    int getSocket() const { return _socket; }
+
+private:
+    int _socket;  ///< Owned socket descriptor, -1 once closed.
+};
+
+}  // namespace mrh
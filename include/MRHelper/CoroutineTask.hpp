@@ -0,0 +1,417 @@
+#pragma once
+
+/**
+ * @brief Non-zero if the library was built with coroutine support.
+ *
+ * Set by the MRHELPER_COROUTINES CMake option, which also switches MRHelper
+ * and its users to C++20.
+ */
+#ifndef MRHELPER_COROUTINES
+#define MRHELPER_COROUTINES 0
+#endif
+
+#if !MRHELPER_COROUTINES
+#error "MRHelper/CoroutineTask.hpp requires configuring MRHelper with -DMRHELPER_COROUTINES=ON"
+#endif
+
+#include <any>
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "MRHelper/Cancellation.hpp"
+#include "MRHelper/ThreadPool.hpp"
+#include "MRHelper/TypedTask.hpp"
+
+namespace mrh {
+
+template <typename T = void>
+class Async;
+
+namespace detail {
+
+/// Promise members shared by Async<T> and Async<void>.
+struct AsyncPromiseBase {
+    /// Resumes the awaiting coroutine when the body has finished.
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            if (std::coroutine_handle<> continuation = handle.promise().continuation)
+                return continuation;
+            return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+
+    std::coroutine_handle<> continuation;  ///< Coroutine awaiting the result.
+    std::exception_ptr error;              ///< Exception that ended the body.
+};
+
+/// Promise of Async<T>.
+template <typename T>
+struct AsyncPromise: AsyncPromiseBase {
+    Async<T> get_return_object() noexcept;
+
+    template <typename U>
+    void return_value(U&& result) {
+        value.emplace(std::forward<U>(result));
+    }
+
+    T take() {
+        if (error)
+            std::rethrow_exception(error);
+        return std::move(*value);
+    }
+
+    std::optional<T> value;  ///< The result.
+};
+
+/// Promise of Async<void>.
+template <>
+struct AsyncPromise<void>: AsyncPromiseBase {
+    Async<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void take() const {
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+
+}  // namespace detail
+
+/**
+ * @brief A lazily started coroutine producing a T.
+ *
+ * The body starts when the Async is co_awaited and the awaiting coroutine
+ * continues on the thread that finishes the body, without a pool round trip.
+ * Exceptions of the body are rethrown by co_await.
+ *
+ * @tparam T Result type, or void.
+ */
+template <typename T>
+class Async {
+public:
+    using promise_type = detail::AsyncPromise<T>;
+
+    explicit Async(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+
+    Async(Async&& other) noexcept : _handle(std::exchange(other._handle, nullptr)) {}
+
+    Async& operator=(Async&& other) noexcept {
+        if (this != &other) {
+            if (_handle)
+                _handle.destroy();
+            _handle = std::exchange(other._handle, nullptr);
+        }
+        return *this;
+    }
+
+    Async(const Async&)            = delete;
+    Async& operator=(const Async&) = delete;
+
+    ~Async() {
+        if (_handle)
+            _handle.destroy();
+    }
+
+    /// Starts the body and suspends the awaiting coroutine until it has finished.
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            bool await_ready() const noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().take(); }
+
+            std::coroutine_handle<promise_type> handle;  ///< The awaited body.
+        };
+        return Awaiter{_handle};
+    }
+
+private:
+    std::coroutine_handle<promise_type> _handle;  ///< Owned coroutine frame.
+};
+
+namespace detail {
+
+template <typename T>
+Async<T> AsyncPromise<T>::get_return_object() noexcept {
+    return Async<T>(std::coroutine_handle<AsyncPromise<T>>::from_promise(*this));
+}
+
+inline Async<void> AsyncPromise<void>::get_return_object() noexcept {
+    return Async<void>(std::coroutine_handle<AsyncPromise<void>>::from_promise(*this));
+}
+
+/// A coroutine that starts right away and frees its frame when it finishes.
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+/**
+ * @brief Suspends a coroutine until a task has been executed.
+ *
+ * The task is executed with Task::executeAsync(). If it completes before the
+ * coroutine has suspended, e.g. because its result is cached, the coroutine
+ * just continues. Otherwise the thread that completes the task posts the
+ * resumption to the pool, which runs it under the coroutine's
+ * CancellationToken. While suspended, the coroutine holds no thread.
+ */
+class TaskAwaiter {
+public:
+    /**
+     * @brief Constructs a TaskAwaiter.
+     *
+     * @param task The task to execute.
+     * @param threadPool Pool that executes dependencies and resumes the coroutine.
+     * @param raw Whether to produce the result as stored by the task instead of the exported one.
+     */
+    TaskAwaiter(std::shared_ptr<Task> task, ThreadPool& threadPool, bool raw)
+        : _task(std::move(task)), _threadPool(threadPool), _raw(raw) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        _handle = handle;
+        _token  = CancellationToken::current();
+        Task::Completion done = [this](std::any result, std::exception_ptr error) {
+            _result = std::move(result);
+            _error  = std::move(error);
+            if (!_completed.exchange(true, std::memory_order_acq_rel))
+                return;  // await_suspend() has not returned yet and continues the coroutine itself.
+            // The coroutine may be resumed, and this awaiter destroyed, as soon as the job is posted.
+            ThreadPool& threadPool = _threadPool;
+            threadPool.post([handle = _handle, token = _token]() {
+                CancellationScope scope(token);
+                handle.resume();
+            });
+        };
+        if (_raw)
+            _task->executeRawAsync(_threadPool, std::move(done));
+        else
+            _task->executeAsync(_threadPool, std::move(done));
+        return !_completed.exchange(true, std::memory_order_acq_rel);
+    }
+
+    std::any await_resume() {
+        if (_error)
+            std::rethrow_exception(_error);
+        return std::move(_result);
+    }
+
+protected:
+    /// Returns true if the result is the one stored by the task.
+    bool isRaw() const { return _raw; }
+
+private:
+    std::shared_ptr<Task> _task;          ///< The awaited task.
+    ThreadPool& _threadPool;              ///< Pool that resumes the coroutine.
+    bool _raw;                            ///< Whether to use Task::executeRawAsync().
+    std::coroutine_handle<> _handle;      ///< The suspended coroutine.
+    CancellationToken _token;             ///< Current token of the suspended coroutine.
+    std::atomic<bool> _completed{false};  ///< Set by the first of the completion and await_suspend().
+    std::any _result;                     ///< Result of the task.
+    std::exception_ptr _error;            ///< Exception of the task.
+};
+
+/// TaskAwaiter producing Result<T>, sharing the result of a TypedTask<T> without copying it.
+template <typename T>
+class ResultAwaiter: public TaskAwaiter {
+public:
+    ResultAwaiter(const std::shared_ptr<Task>& task, ThreadPool& threadPool)
+        : TaskAwaiter(task, threadPool, dynamic_cast<TypedTask<T>*>(task.get()) != nullptr) {}
+
+    Result<T> await_resume() {
+        std::any value = TaskAwaiter::await_resume();
+        if (isRaw())
+            return Result<T>(std::any_cast<std::shared_ptr<const T>>(std::move(value)));
+        return Result<T>(std::make_shared<const T>(std::any_cast<T>(std::move(value))));
+    }
+};
+
+/// Runs the body of a CoroutineTask and reports its result in the format of TypedTask<T>.
+template <typename T>
+Detached runDetached(Async<T> body, Task::Completion done) {
+    std::any raw;
+    std::exception_ptr error;
+    try {
+        // The body's frame is freed before done() runs, which may release the task.
+        Async<T> running = std::move(body);
+        raw = std::shared_ptr<const T>(std::make_shared<const T>(co_await std::move(running)));
+    } catch (...) {
+        error = std::current_exception();
+    }
+    done(std::move(raw), std::move(error));
+}
+
+}  // namespace detail
+
+/**
+ * @brief co_awaits the exported result of a task.
+ *
+ * @param task The task to execute.
+ * @param threadPool Pool that executes dependencies and resumes the coroutine.
+ * @return An awaitable producing what Task::execute() would return.
+ */
+inline detail::TaskAwaiter awaitTask(const std::shared_ptr<Task>& task, ThreadPool& threadPool) {
+    return detail::TaskAwaiter(task, threadPool, false);
+}
+
+/**
+ * @brief co_awaits the result of a task as Result<T>.
+ *
+ * @tparam T Expected result type.
+ * @param task The task to execute.
+ * @param threadPool Pool that executes dependencies and resumes the coroutine.
+ * @return An awaitable producing the shared result; it throws std::bad_any_cast if the task produces another type.
+ */
+template <typename T>
+detail::ResultAwaiter<T> awaitResult(const std::shared_ptr<Task>& task, ThreadPool& threadPool) {
+    return detail::ResultAwaiter<T>(task, threadPool);
+}
+
+/**
+ * @brief Awaitable access to the results of a coroutine task's dependencies.
+ */
+class AsyncInputs {
+public:
+    /**
+     * @brief Constructs AsyncInputs.
+     *
+     * @param dependencies The dependencies of the task.
+     * @param threadPool Thread pool for executing dependencies.
+     */
+    AsyncInputs(const std::vector<std::shared_ptr<Task>>& dependencies, ThreadPool& threadPool)
+        : _dependencies(&dependencies), _threadPool(&threadPool) {}
+
+    /// Returns the number of dependencies.
+    size_t size() const { return _dependencies->size(); }
+
+    /// Returns the pool the task runs on.
+    ThreadPool& getThreadPool() const { return *_threadPool; }
+
+    /**
+     * @brief co_awaits the result of the i-th dependency.
+     *
+     * @tparam T Expected result type.
+     * @param i Index of the dependency.
+     * @return An awaitable producing the shared result.
+     */
+    template <typename T>
+    detail::ResultAwaiter<T> get(size_t i) const {
+        return awaitResult<T>(_dependencies->at(i), *_threadPool);
+    }
+
+    /**
+     * @brief co_awaits the result of the i-th dependency as std::any.
+     * @param i Index of the dependency.
+     * @return An awaitable producing a copy of the result.
+     */
+    detail::TaskAwaiter getAny(size_t i) const { return awaitTask(_dependencies->at(i), *_threadPool); }
+
+private:
+    const std::vector<std::shared_ptr<Task>>* _dependencies;  ///< Dependencies of the task.
+    ThreadPool* _threadPool;                                  ///< Pool for executing dependencies.
+};
+
+/**
+ * @brief A task whose body is a coroutine that co_awaits its dependencies.
+ *
+ * A plain task that waits for a dependency, a nested graph or a MapReduceTask
+ * keeps its pool thread blocked. A coroutine task instead suspends at every
+ * co_await on a result that is not ready yet, e.g. because another execution
+ * of the awaited task is in progress, and is resumed on the pool once it is.
+ * Many executions can therefore be in flight on a small pool.
+ *
+ * The Scheduler and co_await start the body without blocking. Awaited tasks
+ * that are not coroutine tasks themselves run on the awaiting thread, like a
+ * direct call would. Task::execute() blocks the calling thread until the body
+ * has finished; calling it on a pool thread may deadlock a pool whose threads
+ * are all blocked that way.
+ *
+ * The body receives its inputs by value, since a coroutine outlives the call
+ * that created it. Captures of the body function stay valid for the lifetime
+ * of the task.
+ *
+ * Only available when MRHelper is configured with MRHELPER_COROUTINES=ON.
+ *
+ * @tparam T Result type.
+ */
+template <typename T>
+class CoroutineTask: public TypedTask<T> {
+public:
+    /// Type alias for the coroutine body.
+    using Body = std::function<Async<T>(AsyncInputs inputs)>;
+
+    /**
+     * @brief Constructs a CoroutineTask.
+     *
+     * @param body Creates the coroutine computing the result.
+     * @param cacheResult Whether to cache the result.
+     */
+    explicit CoroutineTask(Body body, bool cacheResult = true)
+        : TypedTask<T>({}, cacheResult), _body(std::move(body)) {}
+
+protected:
+    void runAsyncImpl(ThreadPool& threadPool, Task::Completion done) override {
+        std::optional<Async<T>> body;
+        try {
+            body.emplace(_body(AsyncInputs(this->getDependencies(), threadPool)));
+        } catch (...) {
+            done({}, std::current_exception());
+            return;
+        }
+        detail::runDetached(std::move(*body), std::move(done));
+    }
+
+    Result<T> runTyped(ThreadPool& threadPool) override {
+        std::mutex mutex;
+        std::condition_variable finished;
+        bool isDone = false;
+        std::any raw;
+        std::exception_ptr error;
+        runAsyncImpl(threadPool, [&](std::any result, std::exception_ptr exception) {
+            std::lock_guard<std::mutex> lock(mutex);
+            raw    = std::move(result);
+            error  = std::move(exception);
+            isDone = true;
+            finished.notify_all();
+        });
+        std::unique_lock<std::mutex> lock(mutex);
+        const auto region = ThreadPool::blockingRegion();
+        finished.wait(lock, [&isDone] { return isDone; });
+        if (error)
+            std::rethrow_exception(error);
+        return Result<T>(std::any_cast<std::shared_ptr<const T>>(std::move(raw)));
+    }
+
+private:
+    Body _body;  ///< Creates the coroutine computing the result.
+};
+
+}  // namespace mrh
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "MRHelper/Shuffle.hpp"
+
+namespace mrh {
+
+/// Combiner placeholder: emitted pairs are kept as they are.
+struct NoCombiner {};
+
+namespace detail {
+
+/// Map output for one partition, stored as parallel key and value arrays.
+template <typename Key, typename Value>
+struct EmitBuffer {
+    std::vector<Key> keys;      ///< Emitted keys.
+    std::vector<Value> values;  ///< values[i] belongs to keys[i].
+};
+
+}  // namespace detail
+
+/**
+ * @brief Receives the pairs emitted by one map task.
+ *
+ * emit() writes straight into the partition buffer of the key. With a
+ * combiner, every partition instead keeps one value per distinct key and
+ * folds new values into it with `Value combine(Value accumulated, Value emitted)`.
+ * All callables are template parameters, so emit() is inlined into the map
+ * function. A custom partitioner returning an index outside [0, numPartitions)
+ * makes emit() throw std::out_of_range.
+ *
+ * @tparam Key         Key type.
+ * @tparam Value       Value type.
+ * @tparam Combiner    Binary fold over values, or NoCombiner.
+ * @tparam Partitioner Maps a key and the partition count to a partition index.
+ */
+template <typename Key, typename Value, typename Combiner = NoCombiner, typename Partitioner = HashPartitioner<Key>>
+class Emitter {
+public:
+    /// Buffer holding the output of one partition.
+    using Buffer = detail::EmitBuffer<Key, Value>;
+
+    /**
+     * @brief Constructs an Emitter.
+     *
+     * @param numPartitions Number of partitions.
+     * @param combiner Combiner, used unless Combiner is NoCombiner.
+     * @param partitioner Partitioner.
+     */
+    Emitter(size_t numPartitions, const Combiner& combiner, const Partitioner& partitioner = Partitioner())
+        : _buffers(numPartitions), _combiner(combiner), _partitioner(partitioner) {
+        if constexpr (Combining)
+            _indices.resize(numPartitions);
+    }
+
+    Emitter(const Emitter&)            = delete;
+    Emitter& operator=(const Emitter&) = delete;
+
+    /**
+     * @brief Emits a pair.
+     *
+     * @param key Key, or arguments convertible to one.
+     * @param value Value, or arguments convertible to one.
+     */
+    template <typename K, typename V>
+    void emit(K&& key, V&& value) {
+        Key k(std::forward<K>(key));
+        size_t p = 0;
+        if (_buffers.size() > 1) {
+            p = _partitioner(k, _buffers.size());
+            if constexpr (!std::is_same_v<Partitioner, HashPartitioner<Key>>)
+                detail::checkPartition(p, _buffers.size());
+        }
+        Buffer& buffer = _buffers[p];
+        if constexpr (Combining) {
+            const auto [id, inserted] = _indices[p].insert(std::move(k));
+            if (inserted)
+                buffer.values.emplace_back(std::forward<V>(value));
+            else
+                buffer.values[id] = _combiner(std::move(buffer.values[id]), Value(std::forward<V>(value)));
+        } else {
+            buffer.keys.push_back(std::move(k));
+            buffer.values.emplace_back(std::forward<V>(value));
+        }
+    }
+
+    /**
+     * @brief Moves the buffers out of the emitter.
+     * @return One buffer per partition.
+     */
+    std::vector<Buffer> release() {
+        if constexpr (Combining) {
+            for (size_t p = 0; p < _buffers.size(); ++p)
+                _buffers[p].keys = _indices[p].release();
+        }
+        return std::move(_buffers);
+    }
+
+private:
+    static constexpr bool Combining = !std::is_same_v<Combiner, NoCombiner>;
+
+    std::vector<Buffer> _buffers;                 ///< Output per partition.
+    std::vector<detail::KeyIndex<Key>> _indices;  ///< Distinct keys per partition, when combining.
+    const Combiner& _combiner;                    ///< Folds values of equal keys.
+    Partitioner _partitioner;                     ///< Assigns keys to partitions.
+};
+
+}  // namespace mrh
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "MRHelper/Range.hpp"
+#include "MRHelper/Task.hpp"
+
+namespace mrh {
+
+/**
+ * @brief Immutable, flattened form of a task graph.
+ *
+ * Tasks are stored in topological order (dependencies first, the root last),
+ * the dependents of every task as a CSR adjacency list, and the number of
+ * dependencies of every task as an integer indegree. A plan is built once by
+ * Scheduler::compile() and can then be executed any number of times.
+ */
+class ExecutionPlan {
+public:
+    /**
+     * @brief Compiles the graph reachable from root.
+     *
+     * The graph is traversed iteratively, so deep chains cannot overflow the stack.
+     *
+     * @param root The root task.
+     * @throws std::invalid_argument If root is null.
+     * @throws std::logic_error If the graph contains a dependency cycle.
+     */
+    explicit ExecutionPlan(const std::shared_ptr<Task>& root);
+
+    /// Returns the number of tasks in the plan.
+    size_t size() const;
+
+    /// Returns the index of the root task (always size() - 1).
+    uint32_t getRootIndex() const;
+
+    /**
+     * @brief Returns a task by its topological index.
+     * @param index Index in [0, size()).
+     * @return The task.
+     */
+    const std::shared_ptr<Task>& getTask(uint32_t index) const;
+
+    /**
+     * @brief Returns the number of dependencies of a task.
+     * @param index Index in [0, size()).
+     * @return The indegree.
+     */
+    int getIndegree(uint32_t index) const;
+
+    /**
+     * @brief Returns the indices of the tasks that depend on a task.
+     * @param index Index in [0, size()).
+     * @return A view over the dependent indices.
+     */
+    Range<const uint32_t*> getDependents(uint32_t index) const;
+
+    /**
+     * @brief Returns the indices of the tasks without dependencies.
+     * @return The source task indices.
+     */
+    const std::vector<uint32_t>& getSources() const;
+
+private:
+    std::vector<std::shared_ptr<Task>> _tasks;  ///< Tasks in topological order.
+    std::vector<uint32_t> _dependentOffsets;    ///< CSR row offsets, size() + 1 entries.
+    std::vector<uint32_t> _dependents;          ///< CSR column indices.
+    std::vector<int> _indegree;                 ///< Number of dependencies per task.
+    std::vector<uint32_t> _sources;             ///< Tasks with indegree 0.
+};
+
+}  // namespace mrh
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_set>
+
+namespace mrh {
+
+/**
+ * @brief Monotonic arena owned by one map task.
+ *
+ * Allocations are pointer bumps and individual deallocations are no-ops; all
+ * memory is released at once when the arena is destroyed. MapReduceTask keeps
+ * the arenas of a run alive until its reduce phase has finished, so map output
+ * allocated here (std::pmr containers and strings) can flow through the
+ * combiner and the shuffle without being copied. Keys are copied out of the
+ * arena once per distinct key, when they are stored in the result.
+ *
+ * An arena is used by one map task at a time and is not thread-safe.
+ */
+class MapArena {
+public:
+    /// Size of the first block requested from the upstream resource.
+    static constexpr size_t InitialBlockSize = 64 * 1024;
+
+    /**
+     * @brief Constructs a MapArena.
+     * @param initialBlockSize Size of the first block; later blocks grow geometrically.
+     */
+    explicit MapArena(size_t initialBlockSize = InitialBlockSize);
+
+    MapArena(const MapArena&)            = delete;
+    MapArena& operator=(const MapArena&) = delete;
+
+    /// Returns the arena's memory resource.
+    std::pmr::memory_resource* getResource() { return &_resource; }
+
+    /// Returns an allocator for std::pmr containers that allocates from the arena.
+    std::pmr::polymorphic_allocator<std::byte> getAllocator() {
+        return std::pmr::polymorphic_allocator<std::byte>(&_resource);
+    }
+
+    /**
+     * @brief Returns a copy of a string stored once in the arena.
+     *
+     * Equal strings share one copy. The view stays valid until the arena is
+     * released after the reduce phase, so it may be used in values, which the
+     * reducer consumes, but not in keys, which end up in the result.
+     *
+     * @param str The string to intern.
+     * @return A view of the interned copy.
+     */
+    std::string_view intern(std::string_view str);
+
+private:
+    std::pmr::monotonic_buffer_resource _resource;        ///< Backing storage.
+    std::pmr::unordered_set<std::string_view> _interned;  ///< Interned strings, allocated in _resource.
+};
+
+}  // namespace mrh
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "MRHelper/TaskGroup.hpp"
+#include "MRHelper/ThreadPool.hpp"
+#include "MRHelper/Trace.hpp"
+
+namespace mrh {
+
+namespace detail {
+
+/**
+ * @brief Runs the in-memory map, shuffle and reduce phases of a MapReduce job.
+ *
+ * Map task m computes `mapShard(m)`, partition p is grouped by key with
+ * `groupPartition(mapOutputs, p)`, and group i of a partition is reduced with
+ * `reduceGroup(groups, i, slot)` straight into its preallocated result slot.
+ * Groups are reduced in chunks of consecutive keys of one partition.
+ *
+ * On a NumaAware pool, consecutive shards go to the same node and every
+ * partition is grouped and reduced on one node. Map output and groups are
+ * first written by the worker that uses them, so they are allocated on its node.
+ *
+ * @tparam Key            Key type.
+ * @tparam Output         Output type of the reduce function.
+ * @tparam MapShard       Callable as `MapOutput(size_t)`.
+ * @tparam GroupPartition Callable as `Groups(std::vector<MapOutput>&, size_t)`; Groups has size().
+ * @tparam ReduceGroup    Callable as `void(Groups&, size_t, std::pair<Key, Output>&)`.
+ * @param threadPool Thread pool used for parallel execution.
+ * @param numShards Number of map tasks.
+ * @param numPartitions Number of shuffle partitions.
+ * @param chunkSize Keys per reduce task; 0 picks about four chunks per pool thread.
+ * @param offsets Set to the partition boundaries in the result.
+ * @return The reduced pairs in partition order.
+ */
+template <typename Key, typename Output, typename MapShard, typename GroupPartition, typename ReduceGroup>
+std::vector<std::pair<Key, Output>> mapShuffleReduce(ThreadPool& threadPool, size_t numShards, size_t numPartitions,
+                                                     size_t chunkSize, MapShard&& mapShard,
+                                                     GroupPartition&& groupPartition, ReduceGroup&& reduceGroup,
+                                                     std::vector<size_t>& offsets) {
+    using MapOutput = std::decay_t<std::invoke_result_t<MapShard&, size_t>>;
+    using Groups    = std::decay_t<std::invoke_result_t<GroupPartition&, std::vector<MapOutput>&, size_t>>;
+
+    const size_t numNodes = threadPool.getNumNodes();
+    auto partitionNode    = [numNodes](size_t p) { return p % numNodes; };
+
+    // Map phase: one task per shard.
+    MRH_TRACE_BEGIN("MapReduce::map", "mapreduce");
+    std::vector<MapOutput> mapOutputs(numShards);
+    TaskGroup group(threadPool);
+    for (size_t m = 0; m < numShards; ++m) {
+        group.runOnNode(m * numNodes / numShards,
+                        [&mapShard, &output = mapOutputs[m], m]() { output = mapShard(m); });
+    }
+    group.wait();
+    MRH_TRACE_END("MapReduce::map", "mapreduce");
+
+    // Shuffle phase: group every partition by key in parallel.
+    MRH_TRACE_BEGIN("MapReduce::shuffle", "mapreduce");
+    std::vector<Groups> partitions(numPartitions);
+    for (size_t p = 0; p < numPartitions; ++p) {
+        group.runOnNode(partitionNode(p), [&groupPartition, &mapOutputs, &groups = partitions[p], p]() {
+            groups = groupPartition(mapOutputs, p);
+        });
+    }
+    group.wait();
+    mapOutputs.clear();
+    MRH_TRACE_END("MapReduce::shuffle", "mapreduce");
+
+    // Reduce phase: chunks of consecutive keys, each result written into its preallocated slot.
+    MRH_TRACE_BEGIN("MapReduce::reduce", "mapreduce");
+    offsets.assign(numPartitions + 1, 0);
+    for (size_t p = 0; p < numPartitions; ++p) {
+        offsets[p + 1] = offsets[p] + partitions[p].size();
+    }
+    const size_t numKeys    = offsets[numPartitions];
+    const size_t numThreads = std::max<size_t>(1, threadPool.getNumThreads());
+    if (!chunkSize)
+        chunkSize = std::max<size_t>(1, numKeys / (4 * numThreads));
+
+    std::vector<std::pair<Key, Output>> unsorted(numKeys);
+    for (size_t p = 0; p < numPartitions; ++p) {
+        for (size_t first = 0; first < partitions[p].size(); first += chunkSize) {
+            const size_t last = std::min(first + chunkSize, partitions[p].size());
+            Groups* groups    = &partitions[p];
+            auto* slots       = unsorted.data() + offsets[p];
+            group.runOnNode(partitionNode(p), [&reduceGroup, groups, slots, first, last]() {
+                for (size_t i = first; i < last; ++i)
+                    reduceGroup(*groups, i, slots[i]);
+            });
+        }
+    }
+    group.wait();
+    MRH_TRACE_END("MapReduce::reduce", "mapreduce");
+    return unsorted;
+}
+
+/**
+ * @brief Orders reduced pairs by key.
+ *
+ * @param unsorted Reduced pairs; consumed.
+ * @param runs Boundaries of runs already ordered by key, or empty if the pairs are in no particular order.
+ * @return The pairs as a map.
+ */
+template <typename Key, typename Output>
+std::map<Key, Output> sortByKey(std::vector<std::pair<Key, Output>>& unsorted, const std::vector<size_t>& runs) {
+    MRH_TRACE_SCOPE("MapReduce::sort", "mapreduce");
+    auto byKey = [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; };
+    if (runs.empty()) {
+        std::sort(unsorted.begin(), unsorted.end(), byKey);
+    } else {
+        // Every run is already ordered by key: merge them pairwise.
+        const size_t numRuns = runs.size() - 1;
+        for (size_t width = 1; width < numRuns; width *= 2) {
+            for (size_t i = 0; i + width < numRuns; i += 2 * width) {
+                std::inplace_merge(unsorted.begin() + runs[i], unsorted.begin() + runs[i + width],
+                                   unsorted.begin() + runs[std::min(i + 2 * width, numRuns)], byKey);
+            }
+        }
+    }
+    std::map<Key, Output> result;
+    for (auto& kv : unsorted) {
+        result.emplace_hint(result.end(), std::move(kv.first), std::move(kv.second));
+    }
+    return result;
+}
+
+}  // namespace detail
+
+}  // namespace mrh
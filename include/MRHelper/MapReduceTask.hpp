@@ -1,115 +1,610 @@
 #pragma once
 
+#include <algorithm>
 #include <any>
-#include <chrono>
+#include <atomic>
+#include <filesystem>
 #include <functional>
-#include <future>
+#include <iterator>
 #include <map>
-#include <thread>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
 #include <utility>
 #include <vector>
 
+#include "MRHelper/MapArena.hpp"
+#include "MRHelper/MapReducePhases.hpp"
+#include "MRHelper/ProcessExecutor.hpp"
+#include "MRHelper/ResultStore.hpp"
+#include "MRHelper/Shuffle.hpp"
+#include "MRHelper/Spill.hpp"
+#include "MRHelper/Splitter.hpp"
 #include "MRHelper/Task.hpp"
+#include "MRHelper/TaskGroup.hpp"
 #include "MRHelper/ThreadPool.hpp"
+#include "MRHelper/Trace.hpp"
+#include "MRHelper/TypedTask.hpp"
 
 namespace mrh {
 
 /**
  * @brief Template class for generic MapReduce tasks.
  *
+ * The input is split into shards that are mapped in parallel. Map output is
+ * hash-partitioned, each partition is grouped by key on its own pool task, and
+ * groups are then reduced in chunks. Keys must be comparable with operator==
+ * and operator<; keys and outputs must be default constructible. Keys without
+ * an enabled std::hash are always grouped with ShuffleStrategy::Sort, and go to
+ * a single partition unless a custom partitioner is set.
+ *
+ * Map tasks, shuffle partitions and reduce chunks run under the current
+ * CancellationToken: once it is cancelled, none of them starts any more and
+ * execute() throws OperationCancelled.
+ *
  * @tparam Input  Type of input data (e.g. std::vector<T>).
  * @tparam Key    Type of keys produced by the map function.
  * @tparam Value  Type of values associated with keys.
  * @tparam Output Type of the output produced by the reduce function.
+ * @tparam Splitter Splits the input into non-owning shards, one per map task (see WholeInputSplitter).
  */
-template <typename Input, typename Key, typename Value, typename Output>
+template <typename Input, typename Key, typename Value, typename Output,
+          typename Splitter = WholeInputSplitter<Input>>
 class MapReduceTask: public Task {
 public:
+    /// Type alias for the shard of the input handed to one map task.
+    using Shard = typename Splitter::Shard;
     /// Type alias for the map function.
-    using MapFunction = std::function<std::vector<std::pair<Key, Value>>(const Input&)>;
+    using MapFunction = std::function<std::vector<std::pair<Key, Value>>(const Shard&)>;
+    /// Type alias for the output of an arena map function.
+    using ArenaPairs = std::pmr::vector<std::pair<Key, Value>>;
+    /// Type alias for a map function that allocates its output from the map task's arena.
+    using ArenaMapFunction = std::function<ArenaPairs(const Shard&, MapArena&)>;
     /// Type alias for the reduce function.
     using ReduceFunction = std::function<Output(const Key&, const std::vector<Value>&)>;
+    /// Type alias for the combine function: a reduce function whose result is again a Value.
+    using CombineFunction = std::function<Value(const Key&, const std::vector<Value>&)>;
+    /// Type alias for the partition function.
+    using PartitionFunction = std::function<size_t(const Key&, size_t)>;
+    /// Result type when sorted output is enabled (default).
+    using SortedResult = std::map<Key, Output>;
+    /// Result type when sorted output is disabled.
+    using UnsortedResult = std::vector<std::pair<Key, Output>>;
 
     /**
      * @brief Constructs a MapReduceTask.
      *
      * @param mapFunc Map function.
      * @param reduceFunc Reduce function.
-     * @param numMapTasks Number of parallel map tasks.
+     * @param numMapTasks Maximum number of parallel map tasks (shards requested from the splitter).
      * @param cacheResult If true, caches the result.
+     * @param splitter Splitter used to divide the input between map tasks.
      */
-    MapReduceTask(MapFunction mapFunc, ReduceFunction reduceFunc, int numMapTasks = 1, bool cacheResult = true)
+    MapReduceTask(MapFunction mapFunc, ReduceFunction reduceFunc, int numMapTasks = 1, bool cacheResult = true,
+                  Splitter splitter = Splitter())
         : Task(cacheResult)
         , _mapFunc(std::move(mapFunc))
         , _reduceFunc(std::move(reduceFunc))
-        , _numMapTasks(numMapTasks) {}
+        , _numMapTasks(numMapTasks)
+        , _splitter(std::move(splitter)) {}
+
+    /**
+     * @brief Constructs a MapReduceTask whose map tasks allocate from per-task arenas.
+     *
+     * Each map task gets its own MapArena. The map function builds its output
+     * in it, e.g. as `ArenaPairs out(arena.getAllocator())` with std::pmr::string
+     * keys, and the pairs stay in the arena through the combiner and the shuffle.
+     * All arenas are released at once after the reduce phase. With a memory
+     * budget, map output is copied out of the arena before it is buffered.
+     *
+     * @param mapFunc Arena map function.
+     * @param reduceFunc Reduce function.
+     * @param numMapTasks Maximum number of parallel map tasks (shards requested from the splitter).
+     * @param cacheResult If true, caches the result.
+     * @param splitter Splitter used to divide the input between map tasks.
+     */
+    MapReduceTask(ArenaMapFunction mapFunc, ReduceFunction reduceFunc, int numMapTasks = 1, bool cacheResult = true,
+                  Splitter splitter = Splitter())
+        : Task(cacheResult)
+        , _arenaMapFunc(std::move(mapFunc))
+        , _reduceFunc(std::move(reduceFunc))
+        , _numMapTasks(numMapTasks)
+        , _splitter(std::move(splitter)) {}
+
+    /**
+     * @brief Sets the map-side combiner.
+     *
+     * The combiner pre-aggregates the output of each map task by key before the
+     * shuffle, so only one pair per distinct key and map task reaches the reducers.
+     * It must be associative and commutative; a reduce function whose Output is
+     * convertible to Value can usually be passed as is.
+     *
+     * @param combineFunc Combine function, or an empty function to disable combining.
+     */
+    void setCombiner(CombineFunction combineFunc) { _combineFunc = std::move(combineFunc); }
+
+    /**
+     * @brief Sets the number of shuffle partitions.
+     *
+     * Each map task scatters its output into this many partitions, and every
+     * partition is grouped by key on its own pool task.
+     *
+     * @param numPartitions Number of partitions; 0 uses one per pool thread.
+     */
+    void setNumPartitions(size_t numPartitions) { _numPartitions = numPartitions; }
+
+    /**
+     * @brief Sets a custom partitioner.
+     *
+     * @param partitionFunc Function mapping a key and the partition count to a
+     * partition index, or an empty function to use HashPartitioner. An index
+     * outside [0, partition count) makes the execution throw std::out_of_range.
+     */
+    void setPartitioner(PartitionFunction partitionFunc) { _partitionFunc = std::move(partitionFunc); }
+
+    /**
+     * @brief Selects whether the result is ordered by key.
+     *
+     * @param sortedOutput If true (default) the result is a SortedResult,
+     * otherwise an UnsortedResult in partition order.
+     */
+    void setSortedOutput(bool sortedOutput) { _sortedOutput = sortedOutput; }
+
+    /**
+     * @brief Sets how many keys one reduce task processes.
+     *
+     * Larger chunks amortize scheduling overhead for cheap reduce functions,
+     * smaller ones balance expensive ones better.
+     *
+     * @param chunkSize Keys per reduce task; 0 picks about four chunks per pool thread.
+     */
+    void setReduceChunkSize(size_t chunkSize) { _reduceChunkSize = chunkSize; }
+
+    /**
+     * @brief Selects how map output is grouped by key in the shuffle.
+     *
+     * ShuffleStrategy::Sort sorts the pairs of every partition, with a radix
+     * sort for integral and enum keys, so groups reach the reducers in key
+     * order and a sorted result only needs to merge the partitions.
+     *
+     * @param strategy Shuffle strategy; ShuffleStrategy::Hash by default. Ignored for keys without std::hash.
+     */
+    void setShuffleStrategy(ShuffleStrategy strategy) { _shuffleStrategy = strategy; }
+
+    /**
+     * @brief Bounds the memory used for buffered map output.
+     *
+     * With a non-zero budget, partitioned map output is buffered up to the
+     * budget, then sorted and spilled to run files, and the reduce phase merges
+     * the runs. Key and Value need Serializer specializations. The output of a
+     * single map function call is still held in memory.
+     *
+     * @param bytes Budget in bytes across all partitions; 0 (default) keeps everything in memory.
+     */
+    void setMemoryBudget(size_t bytes) { _memoryBudget = bytes; }
+
+    /**
+     * @brief Sets the directory for spilled runs.
+     * @param directory Directory; empty (default) uses the system temporary directory.
+     */
+    void setSpillDirectory(std::filesystem::path directory) { _spillDirectory = std::move(directory); }
+
+    /**
+     * @brief Returns the number of runs spilled to disk by the last execution.
+     * @return The number of run files written.
+     */
+    size_t getSpilledRuns() const { return _spilledRuns; }
+
+    /**
+     * @brief Runs the map and reduce phases in worker processes instead of the thread pool.
+     *
+     * The workers are forked at every execution, so they see the input and
+     * the job's functions. A map task is assigned by shard index; its
+     * partitioned output is sent back to the coordinator, which sends every
+     * partition to the worker that groups and reduces it. A map task or
+     * partition whose worker crashes is run again by another worker. Key,
+     * Value and Output need Serializer specializations. Takes precedence over
+     * setMemoryBudget().
+     *
+     * @param executor The executor, or nullptr (default) to run in the thread pool.
+     */
+    void setProcessExecutor(std::shared_ptr<ProcessExecutor> executor) { _processExecutor = std::move(executor); }
 
 protected:
     /**
      * @brief Executes the MapReduce task.
      *
      * @param threadPool Thread pool used for parallel execution.
-     * @return A std::any containing a std::map<Key, Output> with the results.
+     * @return A std::any containing a SortedResult or, if sorted output is disabled, an UnsortedResult.
      */
     virtual std::any runImpl(ThreadPool& threadPool) override {
-        // Get input data from the first dependency if available.
-        Input input{};
-        if (!getDependencies().empty()) {
-            input = std::any_cast<Input>(getDependencies().front()->execute(threadPool));
-        } else {
-            input = Input();
+        // Get input data from the first dependency if available. Results of a
+        // TypedTask<Input> are shared without copying.
+        Result<Input> inputResult = getDependencies().empty()
+                                        ? Result<Input>(std::make_shared<const Input>())
+                                        : resultOf<Input>(getDependencies().front(), threadPool);
+        const Input& input = inputResult.get();
+
+        // Keys without a hash can only be spread over partitions by a custom partitioner.
+        const size_t numPartitions = !HashableKey && !_partitionFunc ? 1
+                                     : _numPartitions                ? _numPartitions
+                                                     : std::max<size_t>(1, threadPool.getNumThreads());
+
+        // Shards are views into input, which outlives both phases.
+        std::vector<Shard> shards = _splitter.split(input, static_cast<size_t>(std::max(1, _numMapTasks)));
+        std::vector<size_t> runs;
+        UnsortedResult unsorted = _processExecutor ? runInProcesses(shards, numPartitions, runs)
+                                  : _memoryBudget  ? runOutOfCore(threadPool, shards, numPartitions, runs)
+                                                   : runInMemory(threadPool, shards, numPartitions, runs);
+        if (!_sortedOutput)
+            return unsorted;
+
+        return detail::sortByKey(unsorted, runs);
+    }
+
+    bool serializeResult(const std::any& raw, std::ostream& out) const override {
+        return detail::writeAnyResult<SortedResult>(raw, out) || detail::writeAnyResult<UnsortedResult>(raw, out);
+    }
+
+    bool deserializeResult(std::istream& in, std::any& raw) const override {
+        // The entry holds whichever of the two result types the task produced when it was stored.
+        return detail::readAnyResult<SortedResult>(in, raw) || detail::readAnyResult<UnsortedResult>(in, raw);
+    }
+
+private:
+    using Pairs      = std::vector<std::pair<Key, Value>>;
+    using Partitions = std::vector<Pairs>;
+    using Group      = std::pair<Key, std::vector<Value>>;
+
+    /// Whether keys can be hash-partitioned and grouped in a hash table.
+    static constexpr bool HashableKey = detail::IsHashable<Key>::value;
+
+    /// Returns true if the shuffle groups every partition by sorting, so groups come out in key order.
+    bool sortsPartitions() const { return !HashableKey || _shuffleStrategy == ShuffleStrategy::Sort; }
+
+    /**
+     * @brief Groups pairs by key according to the shuffle strategy.
+     *
+     * @param pairs Pairs to group; consumed.
+     * @return One group per distinct key.
+     */
+    std::vector<Group> groupPairs(Pairs& pairs) const {
+        if constexpr (HashableKey) {
+            if (!sortsPartitions()) {
+                detail::GroupTable<Key, Value> table;
+                for (auto& kv : pairs)
+                    table.insert(std::move(kv.first), std::move(kv.second));
+                Pairs().swap(pairs);
+                return table.release();
+            }
         }
+        return detail::sortGroups(pairs);
+    }
 
-        // Map phase: launch _numMapTasks parallel tasks.
-        std::vector<std::future<std::vector<std::pair<Key, Value>>>> mapFutures;
-        for (int i = 0; i < _numMapTasks; ++i) {
-            mapFutures.push_back(threadPool.enqueue([this, input]() { return _mapFunc(input); }));
+    /**
+     * @brief Runs the map, shuffle and reduce phases entirely in memory.
+     *
+     * With an arena map function, every map task gets its own MapArena.
+     *
+     * @param threadPool Thread pool used for parallel execution.
+     * @param shards Input shards, one per map task.
+     * @param numPartitions Number of shuffle partitions.
+     * @param runs Set to the partition boundaries in the result if every partition is ordered by key.
+     * @return The reduced pairs in partition order.
+     */
+    UnsortedResult runInMemory(ThreadPool& threadPool, const std::vector<Shard>& shards, size_t numPartitions,
+                               std::vector<size_t>& runs) const {
+        if (!_arenaMapFunc) {
+            return mapShuffleReduce<Pairs>(threadPool, shards.size(), numPartitions, runs,
+                                           [this, &shards](size_t m) { return _mapFunc(shards[m]); });
         }
+        // One arena per map task, all released together once every group has been reduced.
+        std::vector<std::unique_ptr<MapArena>> arenas(shards.size());
+        auto mapShard = [this, &shards, &arenas](size_t m) {
+            arenas[m] = std::make_unique<MapArena>();
+            return _arenaMapFunc(shards[m], *arenas[m]);
+        };
+        return mapShuffleReduce<ArenaPairs>(threadPool, shards.size(), numPartitions, runs, mapShard);
+    }
+
+    /**
+     * @brief The in-memory map, shuffle and reduce phases for one pair container type.
+     *
+     * @tparam PairsT Container of pairs returned by mapShard.
+     * @tparam MapShard Callable taking a shard index and returning its map output.
+     * @param threadPool Thread pool used for parallel execution.
+     * @param numShards Number of shards.
+     * @param numPartitions Number of shuffle partitions.
+     * @param runs Set to the partition boundaries in the result if every partition is ordered by key.
+     * @param mapShard Runs the map function on one shard.
+     * @return The reduced pairs in partition order.
+     */
+    template <typename PairsT, typename MapShard>
+    UnsortedResult mapShuffleReduce(ThreadPool& threadPool, size_t numShards, size_t numPartitions,
+                                    std::vector<size_t>& runs, MapShard mapShard) const {
+        // Every map task scatters its output into numPartitions buckets.
+        auto mapTask = [this, &mapShard, numPartitions](size_t m) {
+            PairsT pairs = mapShard(m);
+            if (_combineFunc)
+                pairs = combine(std::move(pairs));
+            return partition(std::move(pairs), numPartitions);
+        };
+        auto groupPartition = [this](std::vector<std::vector<PairsT>>& mapOutputs, size_t p) -> std::vector<Group> {
+            if constexpr (HashableKey) {
+                if (!sortsPartitions()) {
+                    detail::GroupTable<Key, Value> table;
+                    for (auto& buckets : mapOutputs) {
+                        for (auto& kv : buckets[p]) {
+                            table.insert(std::move(kv.first), std::move(kv.second));
+                        }
+                        PairsT(buckets[p].get_allocator()).swap(buckets[p]);
+                    }
+                    return table.release();
+                }
+            }
+            size_t numPairs = 0;
+            for (const auto& buckets : mapOutputs)
+                numPairs += buckets[p].size();
+            Pairs pairs;
+            pairs.reserve(numPairs);
+            for (auto& buckets : mapOutputs) {
+                std::move(buckets[p].begin(), buckets[p].end(), std::back_inserter(pairs));
+                PairsT(buckets[p].get_allocator()).swap(buckets[p]);
+            }
+            return detail::sortGroups(pairs);
+        };
+        auto reduceGroup = [this](std::vector<Group>& groups, size_t i, std::pair<Key, Output>& slot) {
+            slot.second = _reduceFunc(groups[i].first, groups[i].second);
+            slot.first  = std::move(groups[i].first);
+            std::vector<Value>().swap(groups[i].second);
+        };
+        std::vector<size_t> offsets;
+        UnsortedResult unsorted = detail::mapShuffleReduce<Key, Output>(
+            threadPool, numShards, numPartitions, _reduceChunkSize, mapTask, groupPartition, reduceGroup, offsets);
+        if (sortsPartitions())
+            runs = std::move(offsets);
+        return unsorted;
+    }
+
+    /**
+     * @brief Runs the job within the memory budget, spilling sorted runs to disk.
+     *
+     * Partitioned map output is buffered per partition; a buffer that exceeds
+     * its share of the budget is sorted and written to a run file. Each
+     * partition is then reduced by streaming a k-way merge over its runs.
+     *
+     * @param threadPool Thread pool used for parallel execution.
+     * @param shards Input shards, one per map task.
+     * @param numPartitions Number of shuffle partitions.
+     * @param runs Set to the partition boundaries in the result.
+     * @return The reduced pairs, sorted by key within each partition.
+     */
+    UnsortedResult runOutOfCore(ThreadPool& threadPool, const std::vector<Shard>& shards, size_t numPartitions,
+                                std::vector<size_t>& runs) {
+        if constexpr (detail::IsSerializable<Key>::value && detail::IsSerializable<Value>::value) {
+            detail::SpillBuffers<Key, Value> buffers(
+                numPartitions, _memoryBudget,
+                _spillDirectory.empty() ? std::filesystem::temp_directory_path() : _spillDirectory);
+
+            // Map phase: partitioned output goes into the budgeted buffers.
+            MRH_TRACE_BEGIN("MapReduce::map", "mapreduce");
+            TaskGroup group(threadPool);
+            for (const Shard& shard : shards) {
+                group.run([this, &shard, &buffers, numPartitions]() {
+                    Pairs pairs;
+                    if (_arenaMapFunc) {
+                        // The arena only lives as long as this map task; copy the pairs out of it.
+                        MapArena arena;
+                        ArenaPairs output = _arenaMapFunc(shard, arena);
+                        pairs.assign(output.begin(), output.end());
+                    } else {
+                        pairs = _mapFunc(shard);
+                    }
+                    if (_combineFunc)
+                        pairs = combine(std::move(pairs));
+                    Partitions buckets = partition(std::move(pairs), numPartitions);
+                    for (size_t p = 0; p < numPartitions; ++p) {
+                        buffers.append(p, buckets[p]);
+                    }
+                });
+            }
+            group.wait();
+            _spilledRuns = buffers.spilledRuns();
+            MRH_TRACE_END("MapReduce::map", "mapreduce");
+
+            // Reduce phase: one task per partition streams its groups out of the merge.
+            MRH_TRACE_BEGIN("MapReduce::reduce", "mapreduce");
+            std::vector<UnsortedResult> outputs(numPartitions);
+            for (size_t p = 0; p < numPartitions; ++p) {
+                group.run([this, &buffers, &output = outputs[p], p]() {
+                    auto cursors = buffers.takeRuns(p);
+                    detail::mergeRuns(cursors, [this, &output](Key&& key, const std::vector<Value>& values) {
+                        Output reduced = _reduceFunc(key, values);
+                        output.emplace_back(std::move(key), std::move(reduced));
+                    });
+                    cursors.clear();
+                    buffers.release(p);
+                });
+            }
+            group.wait();
+            MRH_TRACE_END("MapReduce::reduce", "mapreduce");
 
-        // Collect intermediate results.
-        std::vector<std::pair<Key, Value>> intermediate;
-        for (auto& fut : mapFutures) {
-            while (fut.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready) {
-                threadPool.tryExecuteOne();
-                std::this_thread::yield();
+            UnsortedResult unsorted;
+            runs.assign(1, 0);
+            for (auto& output : outputs) {
+                unsorted.insert(unsorted.end(), std::make_move_iterator(output.begin()),
+                                std::make_move_iterator(output.end()));
+                runs.push_back(unsorted.size());
             }
-            auto partial = fut.get();
-            intermediate.insert(intermediate.end(), partial.begin(), partial.end());
+            return unsorted;
+        } else {
+            throw std::logic_error("MapReduceTask: memory budget requires Serializer specializations of Key and Value");
         }
+    }
+
+    /**
+     * @brief Runs the map and reduce phases in the worker processes of the process executor.
+     *
+     * @param shards Input shards, one per map task.
+     * @param numPartitions Number of shuffle partitions.
+     * @param runs Set to the partition boundaries in the result if every partition is ordered by key.
+     * @return The reduced pairs in partition order.
+     */
+    UnsortedResult runInProcesses(const std::vector<Shard>& shards, size_t numPartitions,
+                                  std::vector<size_t>& runs) const {
+        if constexpr (detail::IsSerializable<Key>::value && detail::IsSerializable<Value>::value &&
+                      detail::IsSerializable<Output>::value) {
+            // Map phase: a request is a shard index, the reply its serialized partition buckets.
+            MRH_TRACE_BEGIN("MapReduce::map", "mapreduce");
+            CancellationToken::current().throwIfCancelled();
+            std::vector<std::string> requests;
+            for (uint64_t m = 0; m < shards.size(); ++m)
+                requests.push_back(detail::encodeMessage(m));
+            auto mapShard = [this, &shards, numPartitions](const std::string& request) {
+                const Shard& shard = shards.at(static_cast<size_t>(detail::decodeMessage<uint64_t>(request)));
+                Pairs pairs;
+                if (_arenaMapFunc) {
+                    MapArena arena;
+                    ArenaPairs output = _arenaMapFunc(shard, arena);
+                    pairs.assign(output.begin(), output.end());
+                } else {
+                    pairs = _mapFunc(shard);
+                }
+                if (_combineFunc)
+                    pairs = combine(std::move(pairs));
+                std::vector<std::string> buckets;
+                for (const Pairs& bucket : partition(std::move(pairs), numPartitions))
+                    buckets.push_back(detail::encodeMessage(bucket));
+                return detail::encodeMessage(buckets);
+            };
+            std::vector<std::string> mapReplies = _processExecutor->run(requests, mapShard);
+            MRH_TRACE_END("MapReduce::map", "mapreduce");
+
+            // Shuffle: the request of partition p collects bucket p of every map task, still serialized.
+            std::vector<std::vector<std::string>> inputs(numPartitions);
+            for (const std::string& reply : mapReplies) {
+                auto buckets = detail::decodeMessage<std::vector<std::string>>(reply);
+                for (size_t p = 0; p < numPartitions && p < buckets.size(); ++p)
+                    inputs[p].push_back(std::move(buckets[p]));
+            }
+            mapReplies.clear();
+            requests.clear();
+            for (const auto& input : inputs)
+                requests.push_back(detail::encodeMessage(input));
+            inputs.clear();
+
+            // Reduce phase: every worker groups one partition by key and reduces the groups.
+            MRH_TRACE_BEGIN("MapReduce::reduce", "mapreduce");
+            CancellationToken::current().throwIfCancelled();
+            auto reducePartition = [this](const std::string& request) {
+                Pairs pairs;
+                for (const std::string& bucket : detail::decodeMessage<std::vector<std::string>>(request)) {
+                    Pairs part = detail::decodeMessage<Pairs>(bucket);
+                    std::move(part.begin(), part.end(), std::back_inserter(pairs));
+                }
+                std::vector<Group> groups = groupPairs(pairs);
+                UnsortedResult output;
+                output.reserve(groups.size());
+                for (auto& group : groups) {
+                    Output reduced = _reduceFunc(group.first, group.second);
+                    output.emplace_back(std::move(group.first), std::move(reduced));
+                }
+                return detail::encodeMessage(output);
+            };
+            std::vector<std::string> reduceReplies = _processExecutor->run(requests, reducePartition);
+            MRH_TRACE_END("MapReduce::reduce", "mapreduce");
 
-        // Shuffle phase: group by key.
-        std::map<Key, std::vector<Value>> groups;
-        for (auto& kv : intermediate) {
-            groups[kv.first].push_back(kv.second);
+            UnsortedResult unsorted;
+            std::vector<size_t> offsets(1, 0);
+            for (const std::string& reply : reduceReplies) {
+                auto output = detail::decodeMessage<UnsortedResult>(reply);
+                unsorted.insert(unsorted.end(), std::make_move_iterator(output.begin()),
+                                std::make_move_iterator(output.end()));
+                offsets.push_back(unsorted.size());
+            }
+            if (sortsPartitions())
+                runs = std::move(offsets);
+            return unsorted;
+        } else {
+            throw std::logic_error(
+                "MapReduceTask: process executor requires Serializer specializations of Key, Value and Output");
         }
+    }
 
-        // Reduce phase: launch parallel reduce tasks.
-        std::vector<std::future<std::pair<Key, Output>>> reduceFutures;
+    /**
+     * @brief Groups the output of one map task by key and applies the combiner to each group.
+     *
+     * @param pairs Output of the map function.
+     * @return One pair per distinct key, using the allocator of pairs.
+     */
+    template <typename PairsT>
+    PairsT combine(PairsT&& pairs) const {
+        std::vector<Group> groups;
+        if constexpr (HashableKey) {
+            detail::GroupTable<Key, Value> table;
+            for (auto& kv : pairs) {
+                table.insert(std::move(kv.first), std::move(kv.second));
+            }
+            groups = table.release();
+        } else {
+            Pairs sorted(std::make_move_iterator(pairs.begin()), std::make_move_iterator(pairs.end()));
+            groups = detail::sortGroups(sorted);
+        }
+        PairsT combined(pairs.get_allocator());
+        combined.reserve(groups.size());
         for (auto& group : groups) {
-            reduceFutures.push_back(threadPool.enqueue([this, key = group.first, values = group.second]() {
-                Output reducedValue = _reduceFunc(key, values);
-                return std::make_pair(key, reducedValue);
-            }));
+            Value value = _combineFunc(group.first, group.second);
+            combined.emplace_back(std::move(group.first), std::move(value));
         }
+        return combined;
+    }
 
-        // Collect reduce results.
-        std::map<Key, Output> result;
-        for (auto& fut : reduceFutures) {
-            while (fut.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready) {
-                threadPool.tryExecuteOne();
-                std::this_thread::yield();
+    /**
+     * @brief Scatters the output of one map task into partitions.
+     *
+     * @param pairs Output of the map (and combine) function.
+     * @param numPartitions Number of partitions.
+     * @return numPartitions buckets of pairs, using the allocator of pairs.
+     */
+    template <typename PairsT>
+    std::vector<PairsT> partition(PairsT&& pairs, size_t numPartitions) const {
+        std::vector<PairsT> buckets;
+        buckets.reserve(numPartitions);
+        if (numPartitions == 1) {
+            buckets.push_back(std::move(pairs));
+            return buckets;
+        }
+        for (size_t p = 0; p < numPartitions; ++p) {
+            buckets.emplace_back(pairs.get_allocator());
+        }
+        for (auto& kv : pairs) {
+            size_t p = 0;
+            if (_partitionFunc) {
+                p = detail::checkPartition(_partitionFunc(kv.first, numPartitions), numPartitions);
+            } else if constexpr (HashableKey) {
+                p = HashPartitioner<Key>()(kv.first, numPartitions);
             }
-            auto kv          = fut.get();
-            result[kv.first] = kv.second;
+            buckets[p].push_back(std::move(kv));
         }
-
-        return result;
+        return buckets;
     }
 
-private:
-    MapFunction _mapFunc;        ///< Map function.
-    ReduceFunction _reduceFunc;  ///< Reduce function.
-    int _numMapTasks;            ///< Number of parallel map tasks.
+    MapFunction _mapFunc;              ///< Map function.
+    ArenaMapFunction _arenaMapFunc;    ///< Arena map function, used instead of _mapFunc if set.
+    ReduceFunction _reduceFunc;        ///< Reduce function.
+    CombineFunction _combineFunc;      ///< Optional map-side combiner.
+    PartitionFunction _partitionFunc;  ///< Optional custom partitioner.
+    int _numMapTasks;                  ///< Number of parallel map tasks.
+    Splitter _splitter;                ///< Splits the input into shards.
+    size_t _numPartitions   = 0;       ///< Number of shuffle partitions, 0 for one per pool thread.
+    size_t _reduceChunkSize = 0;       ///< Keys per reduce task, 0 for automatic.
+    bool _sortedOutput      = true;    ///< Whether the result is ordered by key.
+    size_t _memoryBudget    = 0;       ///< Byte budget for buffered map output, 0 for unlimited.
+    std::filesystem::path _spillDirectory;  ///< Directory for spilled runs.
+    std::atomic<size_t> _spilledRuns{0};    ///< Runs spilled by the last execution.
+    std::shared_ptr<ProcessExecutor> _processExecutor;  ///< Runs map and reduce in processes, if set.
+    ShuffleStrategy _shuffleStrategy = ShuffleStrategy::Hash;  ///< How partitions are grouped by key.
 };
 
 }  // namespace mrh
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+namespace mrh {
+
+/**
+ * @brief A read-only memory mapping of a whole file.
+ *
+ * The mapping is advised for sequential access, so the kernel reads ahead
+ * aggressively and drops pages behind the reader. Pages come from the page
+ * cache and are shared with other mappings of the same file.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief Maps a file.
+     * @param path Path of the file.
+     * @throws std::system_error If the file cannot be opened or mapped.
+     */
+    explicit MappedFile(const std::filesystem::path& path);
+
+    /// Unmaps the file.
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// Returns the first byte of the mapping; nullptr for an empty file.
+    const char* data() const { return _data; }
+
+    /// Returns the file size in bytes.
+    size_t size() const { return _size; }
+
+    /// Returns the contents as a view.
+    std::string_view view() const { return std::string_view(_data, _size); }
+
+    /// Returns the path the file was mapped from.
+    const std::filesystem::path& getPath() const { return _path; }
+
+private:
+    /// Releases the mapping and resets the object to empty.
+    void unmap() noexcept;
+
+    std::filesystem::path _path;  ///< Path of the file.
+    const char* _data = nullptr;  ///< Start of the mapping.
+    size_t _size      = 0;        ///< Length of the mapping.
+};
+
+}  // namespace mrh
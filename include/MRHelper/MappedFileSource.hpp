@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "MRHelper/MappedFile.hpp"
+#include "MRHelper/Splitter.hpp"
+#include "MRHelper/TypedTask.hpp"
+
+namespace mrh {
+
+/**
+ * @brief A set of memory-mapped files holding delimited records.
+ *
+ * Copies share the mappings, which stay valid as long as any copy, or any
+ * Result holding one, is alive.
+ */
+class MappedFiles {
+public:
+    MappedFiles() = default;
+
+    /**
+     * @brief Constructs MappedFiles.
+     *
+     * @param files The mapped files.
+     * @param delimiter Record delimiter.
+     */
+    MappedFiles(std::vector<std::shared_ptr<const MappedFile>> files, char delimiter)
+        : _files(std::move(files)), _delimiter(delimiter) {}
+
+    /// Returns the mapped files.
+    const std::vector<std::shared_ptr<const MappedFile>>& getFiles() const { return _files; }
+
+    /// Returns the record delimiter.
+    char getDelimiter() const { return _delimiter; }
+
+    /// Returns the total size of all files in bytes.
+    size_t getTotalSize() const {
+        size_t total = 0;
+        for (const auto& file : _files)
+            total += file->size();
+        return total;
+    }
+
+    /**
+     * @brief Invokes func for each record of every file, in file order.
+     *
+     * Records are views into the mappings; the delimiter is not part of them.
+     *
+     * @param func Callable taking std::string_view.
+     */
+    template <typename F>
+    void forEachRecord(F&& func) const {
+        for (const auto& file : _files)
+            DelimitedSplitter<>::forEachRecord(file->view(), _delimiter, func);
+    }
+
+private:
+    std::vector<std::shared_ptr<const MappedFile>> _files;  ///< The mapped files.
+    char _delimiter = '\n';                                 ///< Record delimiter.
+};
+
+/**
+ * @brief Splits MappedFiles into record-aligned byte ranges.
+ *
+ * Shards never span files. Each file gets a share of the requested shards
+ * proportional to its size, and its boundaries are moved forward to the next
+ * delimiter, so every record lies in exactly one shard.
+ */
+class MappedFileSplitter {
+public:
+    /// Shard type: a view over whole records of one file.
+    using Shard = std::string_view;
+
+    /**
+     * @brief Splits the files into about numShards record-aligned shards.
+     *
+     * @param input The files to split.
+     * @param numShards Requested number of shards.
+     * @return The shards; at least one, possibly empty.
+     */
+    std::vector<Shard> split(const MappedFiles& input, size_t numShards) const {
+        numShards          = std::max<size_t>(1, numShards);
+        const size_t total = input.getTotalSize();
+
+        std::vector<Shard> shards;
+        for (const auto& file : input.getFiles()) {
+            if (file->size() == 0)
+                continue;
+            const size_t share = std::max<size_t>(1, (numShards * file->size() + total / 2) / total);
+            for (Shard shard : DelimitedSplitter<>::splitView(file->view(), share, input.getDelimiter()))
+                shards.push_back(shard);
+        }
+        if (shards.empty())
+            shards.push_back(Shard());
+        return shards;
+    }
+};
+
+/**
+ * @brief Source task that memory-maps input files.
+ *
+ * The result shares the mappings, so MapReduceTask<MappedFiles, ...,
+ * MappedFileSplitter> hands its map tasks views straight into the page cache
+ * without reading or copying the files.
+ */
+class MappedFileSource: public TypedTask<MappedFiles> {
+public:
+    /**
+     * @brief Constructs a MappedFileSource.
+     *
+     * @param paths Files to map, in record order.
+     * @param delimiter Record delimiter.
+     * @param cacheResult Whether to keep the mappings between executions.
+     */
+    explicit MappedFileSource(std::vector<std::filesystem::path> paths, char delimiter = '\n',
+                              bool cacheResult = true);
+
+    /// Returns the paths of the files.
+    const std::vector<std::filesystem::path>& getPaths() const { return _paths; }
+
+protected:
+    /**
+     * @brief Maps the files.
+     *
+     * @param threadPool Unused; the source has no dependencies.
+     * @return The mapped files.
+     * @throws std::system_error If a file cannot be mapped.
+     */
+    Result<MappedFiles> runTyped(ThreadPool& threadPool) override;
+
+private:
+    std::vector<std::filesystem::path> _paths;  ///< Files to map.
+    char _delimiter;                            ///< Record delimiter.
+};
+
+}  // namespace mrh
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+namespace mrh {
+
+namespace detail {
+
+/**
+ * @brief Allocates a block from the calling thread's block cache.
+ *
+ * Sizes up to 512 bytes are rounded up to a multiple of 64 and recycled through
+ * per-thread free lists; larger sizes go straight to operator new.
+ *
+ * @param bytes Requested size.
+ * @return The block, aligned for std::max_align_t.
+ */
+void* poolAllocate(size_t bytes);
+
+/**
+ * @brief Returns a block obtained from poolAllocate().
+ *
+ * The block joins the calling thread's cache, which may differ from the
+ * allocating thread. Caches are bounded; surplus blocks are freed.
+ *
+ * @param block The block.
+ * @param bytes Size passed to poolAllocate().
+ */
+void poolDeallocate(void* block, size_t bytes) noexcept;
+
+}  // namespace detail
+
+/**
+ * @brief Stateless allocator recycling small blocks through per-thread caches.
+ *
+ * Used for the shared states of futures returned by ThreadPool::enqueue(), which
+ * are allocated and released once per submitted task.
+ *
+ * @tparam T Value type.
+ */
+template <typename T>
+struct PoolAllocator {
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "PoolAllocator: over-aligned type");
+        return static_cast<T*>(detail::poolAllocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept { detail::poolDeallocate(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>&) const noexcept {
+        return false;
+    }
+};
+
+}  // namespace mrh
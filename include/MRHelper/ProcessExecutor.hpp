@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "MRHelper/Channel.hpp"
+#include "MRHelper/Serialization.hpp"
+
+namespace mrh {
+
+namespace detail {
+
+/// Serializes a value into a message payload.
+template <typename T>
+std::string encodeMessage(const T& value) {
+    std::ostringstream out;
+    Serializer<T>::write(out, value);
+    return out.str();
+}
+
+/// Deserializes a message payload written by encodeMessage().
+template <typename T>
+T decodeMessage(const std::string& payload) {
+    std::istringstream in(payload);
+    T value{};
+    if (!Serializer<T>::read(in, value))
+        throw std::runtime_error("ProcessExecutor: malformed message");
+    return value;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Runs requests in local worker processes, surviving workers that crash.
+ *
+ * Every call to run() forks its workers, so they see the caller's memory as it
+ * is at that moment, including the handler and any data it refers to. The
+ * coordinator, which is the calling thread, hands out one request at a time
+ * to each idle worker over a Channel. If a worker dies, its request is given
+ * to a newly forked worker, up to a bounded number of attempts. Exceptions
+ * thrown by the handler do not kill the worker; their message is sent back
+ * and run() rethrows it.
+ *
+ * Workers are forked from a process that may run other threads, of which the
+ * child only inherits the forking one. The handler must therefore not wait for
+ * other threads, e.g. by submitting to a ThreadPool, nor take locks they may
+ * hold. Only supported on POSIX systems; see isSupported().
+ */
+class ProcessExecutor {
+public:
+    /// Computes the reply to one request in a worker process.
+    using Handler = std::function<std::string(const std::string& request)>;
+
+    /**
+     * @brief Constructs a ProcessExecutor.
+     *
+     * @param numProcesses Maximum number of worker processes per run.
+     * @param maxAttempts Number of times a request is tried before run() gives up on it.
+     */
+    explicit ProcessExecutor(size_t numProcesses, size_t maxAttempts = 3);
+
+    /**
+     * @brief Runs every request in a worker process.
+     *
+     * @param requests The requests.
+     * @param handler Computes the reply to a request.
+     * @return The replies, in request order.
+     * @throws std::runtime_error With the handler's message if it threw, or if a request killed maxAttempts workers.
+     * @throws std::system_error If a process or socket cannot be created.
+     */
+    std::vector<std::string> run(const std::vector<std::string>& requests, const Handler& handler);
+
+    /// Returns the maximum number of worker processes per run.
+    size_t getNumProcesses() const { return _numProcesses; }
+
+    /// Returns the number of workers that died and were replaced, over all runs.
+    size_t getNumRestarts() const { return _numRestarts; }
+
+    /// Returns true if worker processes are supported on this platform.
+    static bool isSupported();
+
+    /**
+     * @brief Serves requests from a channel until it is closed.
+     *
+     * This is the main loop of a worker process; it is public so that workers
+     * can also be started by other means than fork, with a handler of their own.
+     *
+     * @param channel Channel to the coordinator.
+     * @param handler Computes the reply to a request.
+     */
+    static void serve(Channel& channel, const Handler& handler);
+
+private:
+    size_t _numProcesses;                 ///< Maximum number of workers per run.
+    size_t _maxAttempts;                  ///< Attempts per request.
+    std::atomic<size_t> _numRestarts{0};  ///< Workers replaced after dying.
+};
+
+}  // namespace mrh
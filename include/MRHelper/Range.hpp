@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+
+namespace mrh {
+
+/**
+ * @brief Non-owning view over an iterator range.
+ *
+ * Used as the shard type for containers split by index range, so that map tasks
+ * read their part of the input in place instead of receiving a copy, and to hand
+ * out adjacency lists of an ExecutionPlan without copying them.
+ *
+ * @tparam Iterator Iterator type of the viewed range.
+ */
+template <typename Iterator>
+class Range {
+public:
+    using iterator        = Iterator;
+    using value_type      = typename std::iterator_traits<Iterator>::value_type;
+    using reference       = typename std::iterator_traits<Iterator>::reference;
+    using difference_type = typename std::iterator_traits<Iterator>::difference_type;
+
+    /// Constructs an empty range.
+    Range() = default;
+
+    /**
+     * @brief Constructs a range over [first, last).
+     *
+     * @param first Iterator to the first element.
+     * @param last Iterator past the last element.
+     */
+    Range(Iterator first, Iterator last) : _first(first), _last(last) {}
+
+    Iterator begin() const { return _first; }
+
+    Iterator end() const { return _last; }
+
+    /// Returns the number of elements in the range.
+    size_t size() const { return static_cast<size_t>(std::distance(_first, _last)); }
+
+    /// Returns true if the range has no elements.
+    bool empty() const { return _first == _last; }
+
+    /// Random access to the i-th element (random-access iterators only).
+    reference operator[](size_t i) const { return _first[static_cast<difference_type>(i)]; }
+
+    reference front() const { return *_first; }
+
+    reference back() const { return *std::prev(_last); }
+
+private:
+    Iterator _first{};  ///< Beginning of the range.
+    Iterator _last{};   ///< End of the range.
+};
+
+}  // namespace mrh
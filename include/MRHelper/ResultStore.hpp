@@ -0,0 +1,177 @@
+#pragma once
+
+#include <any>
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <unordered_map>
+
+#include "MRHelper/Serialization.hpp"
+
+namespace mrh {
+
+/**
+ * @brief Persistent, content-addressed store of serialized task results.
+ *
+ * Entries are files in a directory, named by the fingerprint of the task that
+ * produced them (see Task::setCacheKey()). The store is bounded in size:
+ * when an insertion exceeds the bound, least recently used entries are
+ * removed. Recency is tracked in memory and mirrored in the file
+ * modification times, which order the entries found when a store is opened,
+ * so it survives restarts. One store may be shared by any number of tasks
+ * and threads.
+ */
+class ResultStore {
+public:
+    /**
+     * @brief Opens a store, creating the directory if needed.
+     *
+     * @param directory Directory holding the entries.
+     * @param maxBytes Upper bound on the total size of all entries.
+     * @throws std::filesystem::filesystem_error If the directory cannot be created or listed.
+     */
+    ResultStore(std::filesystem::path directory, uint64_t maxBytes);
+
+    /**
+     * @brief Reads an entry and marks it as recently used.
+     *
+     * @param fingerprint Fingerprint of the entry.
+     * @param bytes Receives the stored bytes.
+     * @return False if there is no such entry.
+     */
+    bool load(uint64_t fingerprint, std::string& bytes);
+
+    /**
+     * @brief Writes an entry, replacing any previous one, and evicts old entries.
+     *
+     * Entries larger than the bound are not stored. A failure to write is
+     * ignored, since the store only saves recomputation.
+     *
+     * @param fingerprint Fingerprint of the entry.
+     * @param bytes Bytes to store.
+     */
+    void store(uint64_t fingerprint, const std::string& bytes);
+
+    /// Returns the total size of all entries in bytes.
+    uint64_t getSize() const;
+
+    /// Returns the number of entries.
+    size_t getNumEntries() const;
+
+    /// Returns the directory holding the entries.
+    const std::filesystem::path& getDirectory() const { return _directory; }
+
+private:
+    struct Entry {
+        uint64_t size;     ///< File size in bytes.
+        uint64_t lastUse;  ///< Value of _clock at the last load or store.
+    };
+
+    /// Returns the file of an entry.
+    std::filesystem::path pathOf(uint64_t fingerprint) const;
+
+    /// Removes least recently used entries until the total size fits the bound. Requires _mutex.
+    void evict();
+
+    std::filesystem::path _directory;              ///< Directory holding the entries.
+    uint64_t _maxBytes;                            ///< Bound on the total size.
+    uint64_t _size = 0;                            ///< Total size of all entries.
+    uint64_t _clock = 0;                           ///< Counts loads and stores; orders entries by recency.
+    std::unordered_map<uint64_t, Entry> _entries;  ///< Entries by fingerprint.
+    mutable std::mutex _mutex;                     ///< Protects _size, _clock and _entries.
+};
+
+namespace detail {
+
+/// 64-bit FNV-1a hash of a byte string; stable across processes and platforms.
+inline uint64_t fingerprintOf(std::string_view bytes) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : bytes) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/// Combines a fingerprint with the fingerprint of a dependency; order-sensitive.
+inline uint64_t combineFingerprints(uint64_t h, uint64_t dependency) {
+    h ^= dependency + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    return h;
+}
+
+/**
+ * @brief Writes a stored result of type T, tagged with the type.
+ *
+ * @param value The value.
+ * @param out Stream to write to.
+ * @return False if T has no Serializer.
+ */
+template <typename T>
+bool writeResult(const T& value, std::ostream& out) {
+    if constexpr (IsSerializable<T>::value) {
+        Serializer<std::string>::write(out, typeid(T).name());
+        Serializer<T>::write(out, value);
+        return true;
+    } else {
+        return false;
+    }
+}
+
+/**
+ * @brief Reads a stored result written by writeResult<T>().
+ *
+ * The stream is left at its original position if the entry holds another type.
+ *
+ * @param in Stream to read from.
+ * @param value Receives the value.
+ * @return False if the entry holds another type, is malformed or T has no Serializer.
+ */
+template <typename T>
+bool readResult(std::istream& in, T& value) {
+    if constexpr (IsSerializable<T>::value) {
+        const auto start = in.tellg();
+        std::string tag;
+        if (Serializer<std::string>::read(in, tag) && tag == typeid(T).name())
+            return Serializer<T>::read(in, value);
+        in.clear();
+        in.seekg(start);
+    }
+    return false;
+}
+
+/**
+ * @brief Writes a result held in a std::any if it has type T.
+ * @return False if the result has another type or T has no Serializer.
+ */
+template <typename T>
+bool writeAnyResult(const std::any& raw, std::ostream& out) {
+    const T* value = std::any_cast<T>(&raw);
+    return value && writeResult(*value, out);
+}
+
+/**
+ * @brief Reads a result of type T into a std::any.
+ * @return False if the entry holds another type or T has no Serializer.
+ */
+template <typename T>
+bool readAnyResult(std::istream& in, std::any& raw) {
+    if constexpr (IsSerializable<T>::value) {
+        T value{};
+        if (!readResult(in, value))
+            return false;
+        raw = std::move(value);
+        return true;
+    } else {
+        return false;
+    }
+}
+
+}  // namespace detail
+
+}  // namespace mrh
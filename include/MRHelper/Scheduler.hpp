@@ -1,11 +1,13 @@
 #pragma once
 
 #include <any>
+#include <atomic>
+#include <cstdint>
 #include <future>
 #include <memory>
-#include <queue>
-#include <unordered_map>
 
+#include "MRHelper/Cancellation.hpp"
+#include "MRHelper/ExecutionPlan.hpp"
 #include "MRHelper/Task.hpp"
 #include "MRHelper/ThreadPool.hpp"
 
@@ -14,10 +16,34 @@ namespace mrh {
 /**
  * @brief Scheduler for executing tasks with dependencies.
  *
- * Builds a dependency graph and executes tasks accordingly.
+ * Compiles the dependency graph into an ExecutionPlan and executes tasks
+ * accordingly. Plans can be compiled once and executed repeatedly. Every task whose
+ * dependencies have finished is dispatched to the thread pool, so independent
+ * branches of the graph run concurrently. Tasks with an up-to-date cached
+ * result are completed inline without a pool round trip, so after
+ * Task::invalidate() an execution only does work for the invalidated subgraph.
+ *
+ * Every execution runs under a CancellationToken. Once it is cancelled or its
+ * deadline passes, no further task of the graph is started, pool work that has
+ * not started is dropped, and the execution throws OperationCancelled after the
+ * running tasks have returned.
  */
 class Scheduler {
 public:
+    /// Order in which tasks that have become ready are dispatched.
+    enum class Policy {
+        Fifo,          ///< In the order the tasks became ready.
+        CriticalPath,  ///< Highest priority first, then the longest remaining path first.
+    };
+
+    /// Aggregate counters over all executions of a Scheduler.
+    struct Stats {
+        uint64_t executions   = 0;  ///< Finished executions of a plan.
+        uint64_t tasksRun     = 0;  ///< Tasks dispatched to the pool.
+        uint64_t tasksSkipped = 0;  ///< Tasks completed inline from their cached result.
+        uint64_t taskTime     = 0;  ///< Wall time spent in dispatched tasks, in nanoseconds.
+    };
+
     /**
      * @brief Constructs a Scheduler.
      *
@@ -25,6 +51,13 @@ public:
      */
     Scheduler(size_t numThreads = std::thread::hardware_concurrency());
 
+    /**
+     * @brief Constructs a Scheduler with an elastic pool.
+     *
+     * @param elasticity Bounds of the pool size.
+     */
+    explicit Scheduler(const ThreadPool::Elasticity& elasticity);
+
     /// Destructor.
     ~Scheduler();
 
@@ -32,34 +65,137 @@ public:
      * @brief Executes the task graph starting from the root.
      *
      * @param root The root task.
+     * @param token Token cancelling the execution; by default the current token of the calling thread.
      * @return The result of the root task as std::any.
+     * @throws std::logic_error If the graph contains a dependency cycle.
+     * @throws OperationCancelled If the token was cancelled before the graph finished.
      */
-    std::any execute(const std::shared_ptr<Task>& root);
+    std::any execute(const std::shared_ptr<Task>& root,
+                     const CancellationToken& token = CancellationToken::current());
+
+    /**
+     * @brief Executes a compiled plan.
+     *
+     * @param plan The plan returned by compile().
+     * @param token Token cancelling the execution; by default the current token of the calling thread.
+     * @return The result of the plan's root task as std::any.
+     * @throws OperationCancelled If the token was cancelled before the graph finished.
+     */
+    std::any execute(const ExecutionPlan& plan, const CancellationToken& token = CancellationToken::current());
+
+    /**
+     * @brief Compiles the task graph starting from the root into a reusable plan.
+     *
+     * @param root The root task.
+     * @return The immutable plan.
+     * @throws std::logic_error If the graph contains a dependency cycle.
+     */
+    static std::shared_ptr<const ExecutionPlan> compile(const std::shared_ptr<Task>& root);
 
     /**
      * @brief Submits the root task for asynchronous execution.
      *
      * @param root The root task.
+     * @param token Token cancelling the execution; cancel it to abandon the job.
+     * @return A future for the result.
+     */
+    std::future<std::any> submit(const std::shared_ptr<Task>& root,
+                                 CancellationToken token = CancellationToken::current());
+
+    /**
+     * @brief Submits a compiled plan for asynchronous execution.
+     *
+     * @param plan The plan returned by compile().
+     * @param token Token cancelling the execution; cancel it to abandon the job.
      * @return A future for the result.
      */
-    std::future<std::any> submit(const std::shared_ptr<Task>& root);
+    std::future<std::any> submit(std::shared_ptr<const ExecutionPlan> plan,
+                                 CancellationToken token = CancellationToken::current());
+
+    /**
+     * @brief Sets whether the first failing task cancels the rest of its execution.
+     *
+     * If enabled, tasks that have not started when a task throws are skipped
+     * instead of running to completion; the execution still rethrows the
+     * first exception. Disabled by default.
+     *
+     * @param cancelOnFailure True to cancel on the first failure.
+     */
+    void setCancelOnFailure(bool cancelOnFailure);
+
+    /**
+     * @brief Returns whether the first failing task cancels the rest of its execution.
+     * @return True if enabled.
+     */
+    bool getCancelOnFailure() const;
+
+    /**
+     * @brief Sets the dispatch order of ready tasks.
+     *
+     * With Policy::CriticalPath (default), ready tasks wait in a priority queue
+     * of the run. The effective priority of a task is the highest
+     * Task::getPriority() among the task and its transitive dependents. Ties
+     * are broken by the estimated length of the longest path from the task to
+     * the root. The length of a task is the runtime it took in the previous
+     * run, or the mean of the known runtimes for tasks that have not run yet.
+     * A long chain thus starts ahead of cheap independent tasks.
+     *
+     * @param policy The policy.
+     */
+    void setPolicy(Policy policy);
+
+    /**
+     * @brief Returns the dispatch order of ready tasks.
+     * @return The policy.
+     */
+    Policy getPolicy() const;
+
+    /**
+     * @brief Returns the counters accumulated since construction or the last resetStats().
+     * @return A snapshot of the counters.
+     */
+    Stats getStats() const;
+
+    /// Resets all counters to zero.
+    void resetStats();
 
 private:
-    ThreadPool _threadPool;  ///< Thread pool for executing tasks.
+    ThreadPool _threadPool;                        ///< Thread pool for executing tasks.
+    Policy _policy        = Policy::CriticalPath;  ///< Dispatch order of ready tasks.
+    bool _cancelOnFailure = false;                 ///< Whether a failure cancels the execution.
+    std::atomic<uint64_t> _executions{0};          ///< See Stats::executions.
+    std::atomic<uint64_t> _tasksRun{0};            ///< See Stats::tasksRun.
+    std::atomic<uint64_t> _tasksSkipped{0};        ///< See Stats::tasksSkipped.
+    std::atomic<uint64_t> _taskTime{0};            ///< See Stats::taskTime.
+
+    /// Per-run state of execute(const ExecutionPlan&).
+    struct Run;
+
+    /**
+     * @brief Runs a ready task of a plan on the pool.
+     *
+     * Under Policy::CriticalPath the task is queued in the run and the pool
+     * job runs whichever queued task comes first. Once a task finishes, every
+     * dependent whose last dependency it was is dispatched in turn.
+     *
+     * @param run State of the current run.
+     * @param index Index of the task in the plan.
+     */
+    void dispatch(Run& run, uint32_t index);
 
     /**
-     * @brief Recursively builds the dependency graph.
+     * @brief Starts a task of a plan; once it completes, dispatches the dependents it unblocks.
      *
-     * @param task Current task.
-     * @param indegree Map of task indegrees.
-     * @param graph Map from each task to its dependents.
-     * @param taskMap Map from task pointers to shared_ptr.
-     * @param visited Map to track visited tasks.
+     * @param run State of the current run.
+     * @param index Index of the task in the plan.
+     */
+    void runTask(Run& run, uint32_t index);
+
+    /**
+     * @brief Computes the dispatch order of the tasks of a run under Policy::CriticalPath.
+     * @param run State of the current run; its ranks are filled in.
      */
-    void buildGraph(const std::shared_ptr<Task>& task, std::unordered_map<Task*, int>& indegree,
-                    std::unordered_map<Task*, std::vector<std::shared_ptr<Task>>>& graph,
-                    std::unordered_map<Task*, std::shared_ptr<Task>>& taskMap,
-                    std::unordered_map<Task*, bool>& visited);
+    static void rankTasks(Run& run);
 };
 
 }  // namespace mrh
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mrh {
+
+/**
+ * @brief Binary serialization trait.
+ *
+ * A specialization for T provides:
+ * - `static void write(std::ostream& out, const T& value)`;
+ * - `static bool read(std::istream& in, T& value)`, returning false at end of
+ *   stream or on malformed input;
+ * - `static size_t size(const T& value)`, the number of bytes write() produces.
+ *
+ * Arithmetic and enum types, std::string (with any allocator), and std::pair,
+ * std::vector and std::map of serializable types are supported out of the box;
+ * specialize the trait for other key, value or result types. The format is
+ * native-endian and meant for local storage.
+ *
+ * @tparam T Serialized type.
+ */
+template <typename T, typename Enable = void>
+struct Serializer;
+
+namespace detail {
+
+/// Writes an unsigned LEB128 varint.
+inline void writeVarint(std::ostream& out, uint64_t value) {
+    char buf[10];
+    size_t n = 0;
+    do {
+        char byte = static_cast<char>(value & 0x7f);
+        value >>= 7;
+        buf[n++] = static_cast<char>(byte | (value ? 0x80 : 0));
+    } while (value);
+    out.write(buf, static_cast<std::streamsize>(n));
+}
+
+/// Reads an unsigned LEB128 varint.
+inline bool readVarint(std::istream& in, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        const int byte = in.get();
+        if (byte == std::char_traits<char>::eof())
+            return false;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+/// Returns the encoded size of a varint.
+inline size_t varintSize(uint64_t value) {
+    size_t n = 1;
+    while (value >>= 7)
+        ++n;
+    return n;
+}
+
+/// Returns the number of bytes left in a seekable stream, or UINT64_MAX if the stream cannot tell.
+inline uint64_t remainingBytes(std::istream& in) {
+    const std::istream::pos_type pos = in.tellg();
+    if (pos == std::istream::pos_type(-1))
+        return UINT64_MAX;
+    in.seekg(0, std::ios::end);
+    const std::istream::pos_type end = in.tellg();
+    in.seekg(pos);
+    return end == std::istream::pos_type(-1) || end < pos ? UINT64_MAX : static_cast<uint64_t>(end - pos);
+}
+
+/**
+ * @brief Checks a decoded element count against the bytes left in the stream.
+ *
+ * Every serialized element takes at least one byte, so a larger count comes
+ * from malformed input and must not be used to size a container.
+ */
+inline bool fitsStream(std::istream& in, uint64_t n) {
+    // Small counts cannot cause a large allocation, so only larger ones pay for the seeks.
+    return n <= 4096 || n <= remainingBytes(in);
+}
+
+/// True if Serializer<T> is specialized, including for the elements of containers.
+template <typename T, typename = void>
+struct IsSerializable: std::false_type {};
+
+template <typename T>
+struct IsSerializable<T, std::void_t<decltype(Serializer<T>::size(std::declval<const T&>()))>>: std::true_type {};
+
+}  // namespace detail
+
+template <typename T>
+struct Serializer<T, std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>>> {
+    static void write(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static bool read(std::istream& in, T& value) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    static size_t size(const T&) { return sizeof(T); }
+};
+
+template <typename Traits, typename Alloc>
+struct Serializer<std::basic_string<char, Traits, Alloc>> {
+    using String = std::basic_string<char, Traits, Alloc>;
+
+    static void write(std::ostream& out, const String& value) {
+        detail::writeVarint(out, value.size());
+        out.write(value.data(), static_cast<std::streamsize>(value.size()));
+    }
+
+    static bool read(std::istream& in, String& value) {
+        uint64_t n = 0;
+        if (!detail::readVarint(in, n) || !detail::fitsStream(in, n))
+            return false;
+        value.resize(static_cast<size_t>(n));
+        return static_cast<bool>(in.read(value.data(), static_cast<std::streamsize>(n)));
+    }
+
+    static size_t size(const String& value) { return detail::varintSize(value.size()) + value.size(); }
+};
+
+template <typename A, typename B>
+struct Serializer<std::pair<A, B>,
+                  std::enable_if_t<detail::IsSerializable<A>::value && detail::IsSerializable<B>::value>> {
+    static void write(std::ostream& out, const std::pair<A, B>& value) {
+        Serializer<A>::write(out, value.first);
+        Serializer<B>::write(out, value.second);
+    }
+
+    static bool read(std::istream& in, std::pair<A, B>& value) {
+        return Serializer<A>::read(in, value.first) && Serializer<B>::read(in, value.second);
+    }
+
+    static size_t size(const std::pair<A, B>& value) {
+        return Serializer<A>::size(value.first) + Serializer<B>::size(value.second);
+    }
+};
+
+template <typename T, typename Alloc>
+struct Serializer<std::vector<T, Alloc>, std::enable_if_t<detail::IsSerializable<T>::value>> {
+    static void write(std::ostream& out, const std::vector<T, Alloc>& value) {
+        detail::writeVarint(out, value.size());
+        for (const T& item : value)
+            Serializer<T>::write(out, item);
+    }
+
+    static bool read(std::istream& in, std::vector<T, Alloc>& value) {
+        uint64_t n = 0;
+        if (!detail::readVarint(in, n) || !detail::fitsStream(in, n))
+            return false;
+        value.clear();
+        value.reserve(static_cast<size_t>(n));
+        for (uint64_t i = 0; i < n; ++i) {
+            T item{};
+            if (!Serializer<T>::read(in, item))
+                return false;
+            value.push_back(std::move(item));
+        }
+        return true;
+    }
+
+    static size_t size(const std::vector<T, Alloc>& value) {
+        size_t total = detail::varintSize(value.size());
+        for (const T& item : value)
+            total += Serializer<T>::size(item);
+        return total;
+    }
+};
+
+template <typename K, typename V, typename Compare, typename Alloc>
+struct Serializer<std::map<K, V, Compare, Alloc>,
+                  std::enable_if_t<detail::IsSerializable<K>::value && detail::IsSerializable<V>::value>> {
+    using Map = std::map<K, V, Compare, Alloc>;
+
+    static void write(std::ostream& out, const Map& value) {
+        detail::writeVarint(out, value.size());
+        for (const auto& kv : value) {
+            Serializer<K>::write(out, kv.first);
+            Serializer<V>::write(out, kv.second);
+        }
+    }
+
+    static bool read(std::istream& in, Map& value) {
+        uint64_t n = 0;
+        if (!detail::readVarint(in, n) || !detail::fitsStream(in, n))
+            return false;
+        value.clear();
+        for (uint64_t i = 0; i < n; ++i) {
+            std::pair<K, V> kv{};
+            if (!Serializer<K>::read(in, kv.first) || !Serializer<V>::read(in, kv.second))
+                return false;
+            value.emplace_hint(value.end(), std::move(kv.first), std::move(kv.second));
+        }
+        return true;
+    }
+
+    static size_t size(const Map& value) {
+        size_t total = detail::varintSize(value.size());
+        for (const auto& kv : value)
+            total += Serializer<K>::size(kv.first) + Serializer<V>::size(kv.second);
+        return total;
+    }
+};
+
+}  // namespace mrh
@@ -0,0 +1,361 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mrh {
+
+namespace detail {
+
+/**
+ * @brief Finalizes a hash value so that all of its bits depend on all input bits.
+ *
+ * std::hash is the identity for integers in common standard libraries, which
+ * would make partition indices and hash table slots correlate.
+ *
+ * @param h Raw hash value.
+ * @return Mixed hash value.
+ */
+inline uint64_t mixHash(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * @brief Open-addressing hash table assigning dense ids to distinct keys.
+ *
+ * Keys are stored densely in insertion order, so the id of a key is its
+ * position in that order; the probe array only holds indices into them, so
+ * growing the table never moves keys.
+ *
+ * @tparam Key  Key type.
+ * @tparam Hash Hash function for keys.
+ */
+template <typename Key, typename Hash = std::hash<Key>>
+class KeyIndex {
+public:
+    /**
+     * @brief Reserves room for the given number of distinct keys.
+     * @param numKeys Expected number of distinct keys.
+     */
+    void reserve(size_t numKeys) {
+        _keys.reserve(numKeys);
+        if (numKeys * 2 > _slots.size())
+            rehash(numKeys * 2);
+    }
+
+    /**
+     * @brief Looks up a key, adding it if it is new.
+     *
+     * @param key The key; moved from only if it is inserted.
+     * @return The id of the key and whether it was inserted.
+     */
+    std::pair<size_t, bool> insert(Key&& key) {
+        if ((_keys.size() + 1) * 2 > _slots.size())
+            rehash(std::max<size_t>(16, _slots.size() * 2));
+
+        const uint64_t h = mixHash(_hash(key));
+        size_t i         = probeStart(h);
+        for (;; i = (i + 1) & _mask) {
+            Slot& slot = _slots[i];
+            if (slot.index == 0) {
+                _keys.push_back(std::move(key));
+                slot.hash  = h;
+                slot.index = _keys.size();
+                return {_keys.size() - 1, true};
+            }
+            if (slot.hash == h && _keys[slot.index - 1] == key)
+                return {slot.index - 1, false};
+        }
+    }
+
+    /// Returns the number of distinct keys.
+    size_t size() const { return _keys.size(); }
+
+    /**
+     * @brief Moves the keys out of the index and clears it.
+     * @return Keys ordered by id.
+     */
+    std::vector<Key> release() {
+        std::vector<Key> keys = std::move(_keys);
+        _keys.clear();
+        _slots.clear();
+        _mask = 0;
+        return keys;
+    }
+
+private:
+    struct Slot {
+        uint64_t hash = 0;  ///< Mixed hash of the key.
+        size_t index  = 0;  ///< One-based index into _keys; zero marks an empty slot.
+    };
+
+    size_t probeStart(uint64_t h) const { return static_cast<size_t>((h >> 32) ^ h) & _mask; }
+
+    void rehash(size_t minSlots) {
+        size_t capacity = 16;
+        while (capacity < minSlots)
+            capacity *= 2;
+        std::vector<Slot> slots(capacity);
+        const size_t mask = capacity - 1;
+        for (const Slot& slot : _slots) {
+            if (slot.index == 0)
+                continue;
+            size_t i = static_cast<size_t>((slot.hash >> 32) ^ slot.hash) & mask;
+            while (slots[i].index != 0)
+                i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+        _slots = std::move(slots);
+        _mask  = mask;
+    }
+
+    std::vector<Key> _keys;    ///< Dense key storage, indexed by id.
+    std::vector<Slot> _slots;  ///< Probe array, capacity is a power of two.
+    size_t _mask = 0;          ///< _slots.size() - 1.
+    Hash _hash;                ///< Key hash function.
+};
+
+/**
+ * @brief Hash table grouping values by key.
+ *
+ * Keys are assigned ids by a KeyIndex; the values of every key are collected
+ * in a vector indexed by the same id.
+ *
+ * @tparam Key   Key type.
+ * @tparam Value Value type.
+ * @tparam Hash  Hash function for keys.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class GroupTable {
+public:
+    /// A key with all values inserted for it.
+    using Group = std::pair<Key, std::vector<Value>>;
+
+    /**
+     * @brief Reserves room for the given number of distinct keys.
+     * @param numKeys Expected number of distinct keys.
+     */
+    void reserve(size_t numKeys) {
+        _index.reserve(numKeys);
+        _values.reserve(numKeys);
+    }
+
+    /**
+     * @brief Appends a value to the group of its key, creating the group if needed.
+     *
+     * @param key The key.
+     * @param value The value.
+     */
+    void insert(Key&& key, Value&& value) {
+        const auto [id, inserted] = _index.insert(std::move(key));
+        if (inserted)
+            _values.emplace_back();
+        _values[id].push_back(std::move(value));
+    }
+
+    /// Returns the number of distinct keys.
+    size_t size() const { return _index.size(); }
+
+    /**
+     * @brief Moves the groups out of the table and clears it.
+     * @return Groups in first-insertion order of their keys.
+     */
+    std::vector<Group> release() {
+        std::vector<Key> keys = _index.release();
+        std::vector<Group> groups;
+        groups.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            groups.emplace_back(std::move(keys[i]), std::move(_values[i]));
+        }
+        _values.clear();
+        return groups;
+    }
+
+private:
+    KeyIndex<Key, Hash> _index;               ///< Ids of the distinct keys.
+    std::vector<std::vector<Value>> _values;  ///< Values of every key, indexed by id.
+};
+
+/// True if std::hash<Key> is enabled, so that keys can be hash-partitioned and grouped in a GroupTable.
+template <typename Key, typename = void>
+struct IsHashable: std::false_type {};
+
+template <typename Key>
+struct IsHashable<Key, std::enable_if_t<std::is_default_constructible_v<std::hash<Key>>>>
+    : std::is_invocable_r<size_t, const std::hash<Key>&, const Key&> {};
+
+/// Integer type holding the bits of a radix-sortable key.
+template <typename Key, bool = std::is_enum_v<Key>>
+struct RadixInteger {
+    using type = Key;
+};
+
+template <typename Key>
+struct RadixInteger<Key, true> {
+    using type = std::underlying_type_t<Key>;
+};
+
+/**
+ * @brief True for keys that radix sortGroups() can order by their bits.
+ *
+ * Integers other than bool, and enums, of at most 64 bits; wider integers such
+ * as the __int128 of GNU mode would be truncated by radixBits().
+ */
+template <typename Key, bool = (std::is_integral_v<Key> && !std::is_same_v<Key, bool>) || std::is_enum_v<Key>>
+struct IsRadixSortable: std::false_type {};
+
+template <typename Key>
+struct IsRadixSortable<Key, true>: std::bool_constant<sizeof(typename RadixInteger<Key>::type) <= sizeof(uint64_t)> {};
+
+/**
+ * @brief Maps a radix-sortable key to an unsigned integer with the same order.
+ * @param key The key.
+ * @return The key bits, with the sign bit flipped for signed types.
+ */
+template <typename Key>
+uint64_t radixBits(Key key) {
+    using Integer  = typename RadixInteger<Key>::type;
+    using Unsigned = std::make_unsigned_t<Integer>;
+    auto bits      = static_cast<Unsigned>(static_cast<Integer>(key));
+    if constexpr (std::is_signed_v<Integer>)
+        bits ^= Unsigned(1) << (8 * sizeof(Unsigned) - 1);
+    return static_cast<uint64_t>(bits);
+}
+
+/**
+ * @brief Stable LSD radix sort by 64-bit integer keys.
+ *
+ * Sorts one byte per pass and only runs passes for bytes that differ between
+ * items, so keys of low cardinality or small range need few passes.
+ *
+ * @param items Items to sort; must be default constructible.
+ * @param bitsOf Returns the sort key of an item as uint64_t.
+ */
+template <typename T, typename BitsOf>
+void radixSort(std::vector<T>& items, BitsOf bitsOf) {
+    if (items.size() < 2)
+        return;
+    const uint64_t first = bitsOf(items.front());
+    uint64_t varying      = 0;
+    for (const T& item : items)
+        varying |= bitsOf(item) ^ first;
+
+    std::vector<T> buffer(items.size());
+    for (unsigned shift = 0; shift < 64 && (varying >> shift) != 0; shift += 8) {
+        if (((varying >> shift) & 0xff) == 0)
+            continue;
+        size_t counts[256] = {};
+        for (const T& item : items)
+            ++counts[(bitsOf(item) >> shift) & 0xff];
+        size_t offset = 0;
+        for (size_t& count : counts) {
+            const size_t n = count;
+            count          = offset;
+            offset += n;
+        }
+        for (T& item : items)
+            buffer[counts[(bitsOf(item) >> shift) & 0xff]++] = std::move(item);
+        items.swap(buffer);
+    }
+}
+
+/**
+ * @brief Groups pairs by sorting them, yielding the groups in key order.
+ *
+ * Integral and enum keys are radix sorted: pairs of trivially copyable types
+ * directly, others through (key bits, index) entries. Other keys are ordered
+ * with a stable comparison sort. All paths keep the values of a key in their
+ * original order.
+ *
+ * @param pairs Pairs to group; consumed.
+ * @return One group per distinct key, ordered by key.
+ */
+template <typename Key, typename Value>
+std::vector<std::pair<Key, std::vector<Value>>> sortGroups(std::vector<std::pair<Key, Value>>& pairs) {
+    std::vector<std::pair<Key, std::vector<Value>>> groups;
+    auto appendRun = [&groups](auto& kv, bool newKey) {
+        if (newKey)
+            groups.emplace_back(std::move(kv.first), std::vector<Value>());
+        groups.back().second.push_back(std::move(kv.second));
+    };
+
+    if constexpr (IsRadixSortable<Key>::value && std::is_trivially_copyable_v<Value> &&
+                  std::is_default_constructible_v<Value>) {
+        radixSort(pairs, [](const std::pair<Key, Value>& kv) { return radixBits(kv.first); });
+        for (size_t i = 0; i < pairs.size(); ++i)
+            appendRun(pairs[i], i == 0 || pairs[i - 1].first != pairs[i].first);
+    } else if constexpr (IsRadixSortable<Key>::value) {
+        std::vector<std::pair<uint64_t, size_t>> entries;
+        entries.reserve(pairs.size());
+        for (size_t i = 0; i < pairs.size(); ++i)
+            entries.emplace_back(radixBits(pairs[i].first), i);
+        radixSort(entries, [](const std::pair<uint64_t, size_t>& entry) { return entry.first; });
+        for (size_t i = 0; i < entries.size(); ++i)
+            appendRun(pairs[entries[i].second], i == 0 || entries[i - 1].first != entries[i].first);
+    } else {
+        std::stable_sort(pairs.begin(), pairs.end(),
+                         [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+        for (auto& kv : pairs)
+            appendRun(kv, groups.empty() || groups.back().first < kv.first);
+    }
+    std::vector<std::pair<Key, Value>>().swap(pairs);
+    return groups;
+}
+
+/**
+ * @brief Checks a partition index returned by a custom partitioner.
+ *
+ * @param p Partition index.
+ * @param numPartitions Number of partitions.
+ * @return p.
+ * @throws std::out_of_range if p is not below numPartitions.
+ */
+inline size_t checkPartition(size_t p, size_t numPartitions) {
+    if (p >= numPartitions) {
+        throw std::out_of_range("MapReduceTask: partitioner returned " + std::to_string(p) + " for " +
+                                std::to_string(numPartitions) + " partitions");
+    }
+    return p;
+}
+
+}  // namespace detail
+
+/// How map output is grouped by key in the shuffle.
+enum class ShuffleStrategy {
+    Hash,  ///< Open-addressing hash table; groups come out in first-occurrence order.
+    Sort   ///< Sort flat (key, value) arrays, radix sort for integral keys; groups come out in key order.
+};
+
+/**
+ * @brief Default partitioner: assigns keys to partitions by hash.
+ *
+ * @tparam Key  Key type.
+ * @tparam Hash Hash function for keys.
+ */
+template <typename Key, typename Hash = std::hash<Key>>
+struct HashPartitioner {
+    /**
+     * @brief Returns the partition of a key.
+     *
+     * @param key The key.
+     * @param numPartitions Total number of partitions.
+     * @return Partition index in [0, numPartitions).
+     */
+    size_t operator()(const Key& key, size_t numPartitions) const {
+        return static_cast<size_t>(detail::mixHash(Hash()(key)) % numPartitions);
+    }
+};
+
+}  // namespace mrh
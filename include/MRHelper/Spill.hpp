@@ -0,0 +1,257 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "MRHelper/Serialization.hpp"
+
+namespace mrh {
+
+namespace detail {
+
+/**
+ * @brief Temporary file that is removed when the object is destroyed.
+ */
+class SpillFile {
+public:
+    /**
+     * @brief Reserves a unique file name in a directory.
+     * @param directory Directory for the file.
+     */
+    explicit SpillFile(const std::filesystem::path& directory) {
+        static std::atomic<uint64_t> counter{0};
+        static const uint64_t salt = (static_cast<uint64_t>(std::random_device()()) << 32) ^ std::random_device()();
+        _path = directory / ("mrh-spill-" + std::to_string(salt) + "-" + std::to_string(counter++) + ".run");
+    }
+
+    ~SpillFile() {
+        std::error_code ec;
+        std::filesystem::remove(_path, ec);
+    }
+
+    SpillFile(const SpillFile&)            = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    /// Returns the file path.
+    const std::filesystem::path& path() const { return _path; }
+
+private:
+    std::filesystem::path _path;  ///< Location of the file.
+};
+
+/// Stream buffer size used for run files.
+constexpr size_t SpillIoBufferSize = 1 << 16;
+
+/**
+ * @brief Sequential reader over one sorted run, stored in a file or in memory.
+ *
+ * A run file holds a varint record count followed by serialized (key, value) pairs.
+ */
+template <typename Key, typename Value>
+class RunCursor {
+public:
+    /// Opens a run file.
+    explicit RunCursor(const SpillFile& file) : _buffer(SpillIoBufferSize) {
+        _file.rdbuf()->pubsetbuf(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+        _file.open(file.path(), std::ios::binary);
+        uint64_t count = 0;
+        if (!_file || !readVarint(_file, count))
+            throw std::runtime_error("MapReduceTask: cannot read spill file " + file.path().string());
+        _remaining = static_cast<size_t>(count);
+    }
+
+    /// Reads a run kept in memory.
+    explicit RunCursor(std::vector<std::pair<Key, Value>>&& pairs)
+        : _memory(std::move(pairs)), _remaining(_memory.size()) {}
+
+    /**
+     * @brief Advances to the next record.
+     * @return False when the run is exhausted.
+     */
+    bool next() {
+        if (_remaining == 0)
+            return false;
+        --_remaining;
+        if (!_file.is_open()) {
+            _current = std::move(_memory[_position++]);
+            return true;
+        }
+        if (!Serializer<Key>::read(_file, _current.first) || !Serializer<Value>::read(_file, _current.second))
+            throw std::runtime_error("MapReduceTask: truncated spill file");
+        return true;
+    }
+
+    /// Returns the current record.
+    std::pair<Key, Value>& current() { return _current; }
+
+private:
+    std::vector<char> _buffer;                   ///< Stream buffer of _file.
+    std::ifstream _file;                         ///< Run file, if the run is on disk.
+    std::vector<std::pair<Key, Value>> _memory;  ///< Records, if the run is in memory.
+    size_t _position  = 0;                       ///< Next record in _memory.
+    size_t _remaining = 0;                       ///< Records not yet returned.
+    std::pair<Key, Value> _current;              ///< Current record.
+};
+
+/**
+ * @brief Per-partition buffers of map output with a memory budget.
+ *
+ * Map tasks append their partitioned output; once a partition's buffer exceeds
+ * its share of the budget it is sorted by key and written to a run file.
+ */
+template <typename Key, typename Value>
+class SpillBuffers {
+public:
+    using Pairs = std::vector<std::pair<Key, Value>>;
+
+    /**
+     * @brief Constructs SpillBuffers.
+     *
+     * @param numPartitions Number of partitions.
+     * @param memoryBudget Total bytes buffered across partitions before spilling.
+     * @param directory Directory for run files.
+     */
+    SpillBuffers(size_t numPartitions, size_t memoryBudget, std::filesystem::path directory)
+        : _partitions(numPartitions)
+        , _limit(std::max<size_t>(1, memoryBudget / numPartitions))
+        , _directory(std::move(directory)) {}
+
+    /**
+     * @brief Appends pairs to a partition, spilling it if it exceeds its budget.
+     *
+     * @param p Partition index.
+     * @param pairs Pairs to append; moved from.
+     */
+    void append(size_t p, Pairs& pairs) {
+        Partition& partition = _partitions[p];
+        Pairs full;
+        {
+            std::lock_guard<std::mutex> lock(partition.mutex);
+            for (auto& kv : pairs) {
+                partition.bytes += sizeof(kv) + Serializer<Key>::size(kv.first) + Serializer<Value>::size(kv.second);
+                partition.buffer.push_back(std::move(kv));
+            }
+            if (partition.bytes > _limit) {
+                full.swap(partition.buffer);
+                partition.bytes = 0;
+            }
+        }
+        pairs.clear();
+        if (!full.empty())
+            spill(partition, full);
+    }
+
+    /**
+     * @brief Returns cursors over all runs of a partition, including the in-memory remainder.
+     * @param p Partition index.
+     * @return One cursor per run.
+     */
+    std::vector<std::unique_ptr<RunCursor<Key, Value>>> takeRuns(size_t p) {
+        Partition& partition = _partitions[p];
+        std::vector<std::unique_ptr<RunCursor<Key, Value>>> cursors;
+        for (const auto& file : partition.files)
+            cursors.push_back(std::make_unique<RunCursor<Key, Value>>(*file));
+        sortRun(partition.buffer);
+        cursors.push_back(std::make_unique<RunCursor<Key, Value>>(std::move(partition.buffer)));
+        return cursors;
+    }
+
+    /// Releases the run files of a partition.
+    void release(size_t p) { _partitions[p].files.clear(); }
+
+    /// Returns the number of runs written to disk so far.
+    size_t spilledRuns() const { return _spilledRuns; }
+
+private:
+    struct Partition {
+        std::mutex mutex;                                ///< Protects buffer, bytes and files.
+        Pairs buffer;                                    ///< Buffered pairs.
+        size_t bytes = 0;                                ///< Estimated size of buffer.
+        std::vector<std::unique_ptr<SpillFile>> files;  ///< Spilled runs.
+    };
+
+    static void sortRun(Pairs& pairs) {
+        std::stable_sort(pairs.begin(), pairs.end(),
+                         [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    }
+
+    void spill(Partition& partition, Pairs& pairs) {
+        sortRun(pairs);
+        auto file = std::make_unique<SpillFile>(_directory);
+        {
+            std::vector<char> buffer(SpillIoBufferSize);
+            std::ofstream out;
+            out.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            out.open(file->path(), std::ios::binary | std::ios::trunc);
+            writeVarint(out, pairs.size());
+            for (const auto& kv : pairs) {
+                Serializer<Key>::write(out, kv.first);
+                Serializer<Value>::write(out, kv.second);
+            }
+            out.flush();
+            if (!out)
+                throw std::runtime_error("MapReduceTask: cannot write spill file " + file->path().string());
+        }
+        Pairs().swap(pairs);
+        ++_spilledRuns;
+        std::lock_guard<std::mutex> lock(partition.mutex);
+        partition.files.push_back(std::move(file));
+    }
+
+    std::vector<Partition> _partitions;   ///< One buffer per partition.
+    size_t _limit;                        ///< Byte budget per partition.
+    std::filesystem::path _directory;     ///< Directory for run files.
+    std::atomic<size_t> _spilledRuns{0};  ///< Runs written to disk.
+};
+
+/**
+ * @brief Streams the groups of a partition by k-way merging its sorted runs.
+ *
+ * @param cursors Cursors over the runs.
+ * @param func Called with each key and all of its values, in key order.
+ */
+template <typename Key, typename Value, typename F>
+void mergeRuns(std::vector<std::unique_ptr<RunCursor<Key, Value>>>& cursors, F&& func) {
+    // Min-heap of cursor indices ordered by their current key.
+    auto greater = [&cursors](size_t lhs, size_t rhs) {
+        return cursors[rhs]->current().first < cursors[lhs]->current().first;
+    };
+    std::vector<size_t> heap;
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        if (cursors[i]->next())
+            heap.push_back(i);
+    }
+    std::make_heap(heap.begin(), heap.end(), greater);
+
+    std::vector<Value> values;
+    while (!heap.empty()) {
+        Key key = cursors[heap.front()]->current().first;
+        values.clear();
+        while (!heap.empty() && !(key < cursors[heap.front()]->current().first)) {
+            std::pop_heap(heap.begin(), heap.end(), greater);
+            const size_t i = heap.back();
+            values.push_back(std::move(cursors[i]->current().second));
+            if (cursors[i]->next())
+                std::push_heap(heap.begin(), heap.end(), greater);
+            else
+                heap.pop_back();
+        }
+        func(std::move(key), values);
+    }
+}
+
+}  // namespace detail
+
+}  // namespace mrh
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "MRHelper/Range.hpp"
+
+namespace mrh {
+
+/**
+ * @brief Splitter that hands the whole input to a single map task.
+ *
+ * This is the default splitter of MapReduceTask. It always produces exactly one
+ * shard, a reference to the input, so map functions taking `const Input&` keep
+ * working unchanged and raising the number of map tasks never duplicates work.
+ *
+ * A splitter is any type that provides:
+ * - a `Shard` type alias: the non-owning view passed to the map function;
+ * - `std::vector<Shard> split(const Input& input, size_t numShards) const`,
+ *   returning at least one and at most `numShards` shards that together cover
+ *   the input exactly once.
+ *
+ * @tparam Input Type of the input data.
+ */
+template <typename Input>
+class WholeInputSplitter {
+public:
+    /// Shard type: a reference to the whole input.
+    using Shard = std::reference_wrapper<const Input>;
+
+    /**
+     * @brief Returns a single shard referring to the whole input.
+     *
+     * @param input The input data.
+     * @return A vector containing one shard.
+     */
+    std::vector<Shard> split(const Input& input, size_t /*numShards*/) const { return {std::cref(input)}; }
+};
+
+/**
+ * @brief Splits a random-access container into contiguous index ranges.
+ *
+ * Shards are balanced to within one element of each other.
+ *
+ * @tparam Container Random-access container type (e.g. std::vector<T>).
+ */
+template <typename Container>
+class RangeSplitter {
+public:
+    /// Shard type: a view over a sub-range of the container.
+    using Shard = Range<typename Container::const_iterator>;
+
+    /**
+     * @brief Splits the container into at most numShards index ranges.
+     *
+     * @param input The container to split.
+     * @param numShards Requested number of shards.
+     * @return The shards; at least one, possibly empty.
+     */
+    std::vector<Shard> split(const Container& input, size_t numShards) const {
+        const size_t size = input.size();
+        numShards         = std::max<size_t>(1, std::min(numShards, size));
+
+        std::vector<Shard> shards;
+        shards.reserve(numShards);
+        auto first = input.begin();
+        for (size_t i = 0; i < numShards; ++i) {
+            const size_t lo = i * size / numShards;
+            const size_t hi = (i + 1) * size / numShards;
+            shards.emplace_back(first + lo, first + hi);
+        }
+        return shards;
+    }
+};
+
+/**
+ * @brief Splits a character buffer on record boundaries.
+ *
+ * Each shard ends right after a delimiter (or at the end of the buffer), so no
+ * record is ever cut between two map tasks.
+ *
+ * @tparam Buffer Contiguous character buffer (std::string, std::string_view, std::vector<char>, ...).
+ */
+template <typename Buffer = std::string_view>
+class DelimitedSplitter {
+public:
+    /// Shard type: a view over whole records of the buffer.
+    using Shard = std::string_view;
+
+    /**
+     * @brief Constructs a DelimitedSplitter.
+     *
+     * @param delimiter Record delimiter.
+     */
+    explicit DelimitedSplitter(char delimiter = '\n') : _delimiter(delimiter) {}
+
+    /**
+     * @brief Splits the buffer into at most numShards record-aligned shards.
+     *
+     * @param input The buffer to split.
+     * @param numShards Requested number of shards.
+     * @return The shards; at least one, possibly empty.
+     */
+    std::vector<Shard> split(const Buffer& input, size_t numShards) const {
+        return splitView(std::string_view(input.data(), input.size()), numShards, _delimiter);
+    }
+
+    /**
+     * @brief Invokes func for each record of a shard.
+     *
+     * The delimiter is not part of the records. A trailing delimiter does not
+     * produce an empty record.
+     *
+     * @param shard The shard to iterate.
+     * @param func Callable taking std::string_view.
+     */
+    template <typename F>
+    void forEachRecord(std::string_view shard, F&& func) const {
+        forEachRecord(shard, _delimiter, std::forward<F>(func));
+    }
+
+    /// Static form of forEachRecord() taking an explicit delimiter.
+    template <typename F>
+    static void forEachRecord(std::string_view shard, char delimiter, F&& func) {
+        while (!shard.empty()) {
+            const size_t pos = shard.find(delimiter);
+            if (pos == std::string_view::npos) {
+                func(shard);
+                return;
+            }
+            func(shard.substr(0, pos));
+            shard.remove_prefix(pos + 1);
+        }
+    }
+
+    /**
+     * @brief Splits a character view into record-aligned shards.
+     *
+     * @param data The bytes to split.
+     * @param numShards Requested number of shards.
+     * @param delimiter Record delimiter.
+     * @return The shards; at least one, possibly empty.
+     */
+    static std::vector<Shard> splitView(std::string_view data, size_t numShards, char delimiter) {
+        numShards = std::max<size_t>(1, numShards);
+
+        std::vector<Shard> shards;
+        shards.reserve(numShards);
+        size_t begin = 0;
+        for (size_t i = 1; i <= numShards && begin < data.size(); ++i) {
+            size_t end = i == numShards ? data.size() : std::max(begin, i * data.size() / numShards);
+            if (end < data.size()) {
+                // Extend to the end of the record the boundary falls into.
+                const size_t pos = end == 0 ? data.find(delimiter) : data.find(delimiter, end - 1);
+                end              = pos == std::string_view::npos ? data.size() : pos + 1;
+            }
+            if (end > begin)
+                shards.push_back(data.substr(begin, end - begin));
+            begin = end;
+        }
+        if (shards.empty())
+            shards.push_back(data.substr(0, 0));
+        return shards;
+    }
+
+private:
+    char _delimiter;  ///< Record delimiter.
+};
+
+/**
+ * @brief Splitter backed by a user-supplied function.
+ *
+ * @tparam Input Type of the input data.
+ * @tparam ShardT Non-owning shard type produced by the function.
+ */
+template <typename Input, typename ShardT>
+class CustomSplitter {
+public:
+    /// Shard type produced by the split function.
+    using Shard = ShardT;
+    /// Type alias for the split function.
+    using SplitFunction = std::function<std::vector<Shard>(const Input&, size_t)>;
+
+    /**
+     * @brief Constructs a CustomSplitter.
+     *
+     * @param func Function returning the shards for an input and a requested shard count.
+     */
+    explicit CustomSplitter(SplitFunction func = {}) : _func(std::move(func)) {}
+
+    std::vector<Shard> split(const Input& input, size_t numShards) const { return _func(input, numShards); }
+
+private:
+    SplitFunction _func;  ///< User-supplied split function.
+};
+
+}  // namespace mrh
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <algorithm>
+#include <any>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "MRHelper/Emitter.hpp"
+#include "MRHelper/MapReducePhases.hpp"
+#include "MRHelper/Shuffle.hpp"
+#include "MRHelper/Splitter.hpp"
+#include "MRHelper/Task.hpp"
+#include "MRHelper/ThreadPool.hpp"
+#include "MRHelper/TypedTask.hpp"
+
+namespace mrh {
+
+/**
+ * @brief MapReduce task with statically dispatched map, combine and reduce callables.
+ *
+ * Counterpart of MapReduceTask for tight jobs. The map function is called as
+ * `mapFunc(shard, emitter)` and emits pairs with `emitter.emit(key, value)`
+ * straight into the partition buffers, or into the combiner if one is given.
+ * Every partition is grouped into one contiguous value array, and the reduce
+ * function is called as `reduceFunc(key, values)` with a ValueRange over the
+ * values of the key. No std::function or per-call container is involved, so
+ * the callables are inlined into the map and reduce loops.
+ *
+ * The result types and the requirements on keys match MapReduceTask; values
+ * must be default constructible. Memory budgets and arenas are not supported
+ * by this form. Use makeMapReduceTask() to deduce the callable types.
+ *
+ * @tparam Input       Type of input data.
+ * @tparam Key         Type of keys emitted by the map function.
+ * @tparam Value       Type of values emitted by the map function.
+ * @tparam MapFunc     Callable as `void(const Shard&, EmitterType&)`.
+ * @tparam ReduceFunc  Callable as `Output(const Key&, ValueRange)`.
+ * @tparam Combiner    Callable as `Value(Value, Value)`, or NoCombiner.
+ * @tparam Splitter    Splits the input into non-owning shards, one per map task.
+ * @tparam Partitioner Maps a key and the partition count to a partition index.
+ */
+template <typename Input, typename Key, typename Value, typename MapFunc, typename ReduceFunc,
+          typename Combiner = NoCombiner, typename Splitter = WholeInputSplitter<Input>,
+          typename Partitioner = HashPartitioner<Key>>
+class StaticMapReduceTask: public Task {
+public:
+    /// Type alias for the shard of the input handed to one map task.
+    using Shard = typename Splitter::Shard;
+    /// Type of the emitter passed to the map function.
+    using EmitterType = Emitter<Key, Value, Combiner, Partitioner>;
+    /// Contiguous values of one key, passed to the reduce function.
+    using ValueRange = Range<const Value*>;
+    /// Type of the output produced by the reduce function.
+    using Output = std::decay_t<std::invoke_result_t<ReduceFunc&, const Key&, ValueRange>>;
+    /// Result type when sorted output is enabled (default).
+    using SortedResult = std::map<Key, Output>;
+    /// Result type when sorted output is disabled.
+    using UnsortedResult = std::vector<std::pair<Key, Output>>;
+
+    /**
+     * @brief Constructs a StaticMapReduceTask.
+     *
+     * @param mapFunc Map function.
+     * @param reduceFunc Reduce function.
+     * @param combiner Map-side combiner; must be associative and commutative.
+     * @param numMapTasks Maximum number of parallel map tasks (shards requested from the splitter).
+     * @param cacheResult If true, caches the result.
+     * @param splitter Splitter used to divide the input between map tasks.
+     */
+    StaticMapReduceTask(MapFunc mapFunc, ReduceFunc reduceFunc, Combiner combiner = Combiner(), int numMapTasks = 1,
+                        bool cacheResult = true, Splitter splitter = Splitter())
+        : Task(cacheResult)
+        , _mapFunc(std::move(mapFunc))
+        , _reduceFunc(std::move(reduceFunc))
+        , _combiner(std::move(combiner))
+        , _numMapTasks(numMapTasks)
+        , _splitter(std::move(splitter)) {}
+
+    /**
+     * @brief Sets the number of shuffle partitions.
+     * @param numPartitions Number of partitions; 0 uses one per pool thread.
+     */
+    void setNumPartitions(size_t numPartitions) { _numPartitions = numPartitions; }
+
+    /**
+     * @brief Sets the partitioner.
+     *
+     * @param partitioner Partitioner. An index outside [0, partition count)
+     * makes the execution throw std::out_of_range.
+     */
+    void setPartitioner(Partitioner partitioner) { _partitioner = std::move(partitioner); }
+
+    /**
+     * @brief Selects whether the result is ordered by key.
+     *
+     * @param sortedOutput If true (default) the result is a SortedResult,
+     * otherwise an UnsortedResult in partition order.
+     */
+    void setSortedOutput(bool sortedOutput) { _sortedOutput = sortedOutput; }
+
+    /**
+     * @brief Sets the number of keys reduced by one pool task.
+     * @param chunkSize Keys per reduce task; 0 (default) picks about four chunks per pool thread.
+     */
+    void setReduceChunkSize(size_t chunkSize) { _reduceChunkSize = chunkSize; }
+
+protected:
+    /**
+     * @brief Executes the MapReduce task.
+     *
+     * @param threadPool Thread pool used for parallel execution.
+     * @return A std::any containing a SortedResult or, if sorted output is disabled, an UnsortedResult.
+     */
+    std::any runImpl(ThreadPool& threadPool) override {
+        Result<Input> inputResult = getDependencies().empty()
+                                        ? Result<Input>(std::make_shared<const Input>())
+                                        : resultOf<Input>(getDependencies().front(), threadPool);
+        const Input& input = inputResult.get();
+
+        const size_t numPartitions =
+            _numPartitions ? _numPartitions : std::max<size_t>(1, threadPool.getNumThreads());
+        std::vector<Shard> shards = _splitter.split(input, static_cast<size_t>(std::max(1, _numMapTasks)));
+
+        // Every map task emits into its own per-partition buffers, and every
+        // partition is grouped into contiguous value arrays.
+        auto mapTask = [this, &shards, numPartitions](size_t m) {
+            EmitterType emitter(numPartitions, _combiner, _partitioner);
+            _mapFunc(shards[m], emitter);
+            return emitter.release();
+        };
+        auto reduceGroup = [this](Groups& groups, size_t i, std::pair<Key, Output>& slot) {
+            const Value* values = groups.values.data();
+            const ValueRange range(values + groups.offsets[i], values + groups.offsets[i + 1]);
+            slot.second = _reduceFunc(static_cast<const Key&>(groups.keys[i]), range);
+            slot.first  = std::move(groups.keys[i]);
+        };
+        std::vector<size_t> offsets;
+        UnsortedResult unsorted = detail::mapShuffleReduce<Key, Output>(
+            threadPool, shards.size(), numPartitions, _reduceChunkSize, mapTask, &groupPartition, reduceGroup, offsets);
+        if (!_sortedOutput)
+            return unsorted;
+
+        return detail::sortByKey(unsorted, {});
+    }
+
+private:
+    using Buffer = typename EmitterType::Buffer;
+
+    /// The groups of one partition: values[offsets[i], offsets[i + 1]) belong to keys[i].
+    struct Groups {
+        std::vector<Key> keys;        ///< Distinct keys.
+        std::vector<size_t> offsets;  ///< keys.size() + 1 offsets into values.
+        std::vector<Value> values;    ///< Values ordered by key.
+
+        /// Returns the number of distinct keys.
+        size_t size() const { return keys.size(); }
+    };
+
+    /**
+     * @brief Groups partition p of all map outputs with a counting sort over key ids.
+     *
+     * @param mapOutputs Per-partition buffers of every map task; partition p is consumed.
+     * @param p Partition index.
+     * @return The groups of the partition.
+     */
+    static Groups groupPartition(std::vector<std::vector<Buffer>>& mapOutputs, size_t p) {
+        size_t numPairs = 0;
+        for (const auto& buffers : mapOutputs)
+            numPairs += buffers[p].keys.size();
+
+        detail::KeyIndex<Key> index;
+        std::vector<size_t> ids;
+        std::vector<size_t> counts;
+        ids.reserve(numPairs);
+        for (auto& buffers : mapOutputs) {
+            for (Key& key : buffers[p].keys) {
+                const auto [id, inserted] = index.insert(std::move(key));
+                if (inserted)
+                    counts.push_back(0);
+                ++counts[id];
+                ids.push_back(id);
+            }
+            std::vector<Key>().swap(buffers[p].keys);
+        }
+
+        Groups groups;
+        groups.offsets.resize(counts.size() + 1, 0);
+        for (size_t i = 0; i < counts.size(); ++i)
+            groups.offsets[i + 1] = groups.offsets[i] + counts[i];
+
+        // Scatter values to their key's slice; counts becomes the next free position.
+        std::copy(groups.offsets.begin(), groups.offsets.end() - 1, counts.begin());
+        groups.values.resize(numPairs);
+        size_t next = 0;
+        for (auto& buffers : mapOutputs) {
+            for (Value& value : buffers[p].values)
+                groups.values[counts[ids[next++]]++] = std::move(value);
+            std::vector<Value>().swap(buffers[p].values);
+        }
+        groups.keys = index.release();
+        return groups;
+    }
+
+    MapFunc _mapFunc;                ///< Map function.
+    ReduceFunc _reduceFunc;          ///< Reduce function.
+    Combiner _combiner;              ///< Map-side combiner, or NoCombiner.
+    int _numMapTasks;                ///< Number of parallel map tasks.
+    Splitter _splitter;              ///< Splits the input into shards.
+    Partitioner _partitioner;        ///< Assigns keys to partitions.
+    size_t _numPartitions   = 0;     ///< Number of shuffle partitions, 0 for one per pool thread.
+    size_t _reduceChunkSize = 0;     ///< Keys per reduce task, 0 for automatic.
+    bool _sortedOutput      = true;  ///< Whether the result is ordered by key.
+};
+
+/**
+ * @brief Creates a StaticMapReduceTask, deducing the callable types.
+ *
+ * @tparam Input    Type of input data.
+ * @tparam Key      Type of emitted keys.
+ * @tparam Value    Type of emitted values.
+ * @tparam Splitter Splitter type.
+ * @param mapFunc Map function.
+ * @param reduceFunc Reduce function.
+ * @param numMapTasks Maximum number of parallel map tasks.
+ * @param splitter Splitter used to divide the input between map tasks.
+ * @return The new task.
+ */
+template <typename Input, typename Key, typename Value, typename Splitter = WholeInputSplitter<Input>,
+          typename MapFunc, typename ReduceFunc>
+auto makeMapReduceTask(MapFunc mapFunc, ReduceFunc reduceFunc, int numMapTasks = 1, Splitter splitter = Splitter()) {
+    using TaskType = StaticMapReduceTask<Input, Key, Value, MapFunc, ReduceFunc, NoCombiner, Splitter>;
+    return std::make_shared<TaskType>(std::move(mapFunc), std::move(reduceFunc), NoCombiner(), numMapTasks, true,
+                                      std::move(splitter));
+}
+
+/**
+ * @brief Creates a StaticMapReduceTask with a map-side combiner, deducing the callable types.
+ *
+ * @tparam Input    Type of input data.
+ * @tparam Key      Type of emitted keys.
+ * @tparam Value    Type of emitted values.
+ * @tparam Splitter Splitter type.
+ * @param mapFunc Map function.
+ * @param reduceFunc Reduce function.
+ * @param combiner Folds two values of the same key into one.
+ * @param numMapTasks Maximum number of parallel map tasks.
+ * @param splitter Splitter used to divide the input between map tasks.
+ * @return The new task.
+ */
+template <typename Input, typename Key, typename Value, typename Splitter = WholeInputSplitter<Input>,
+          typename MapFunc, typename ReduceFunc, typename Combiner>
+auto makeMapReduceTask(MapFunc mapFunc, ReduceFunc reduceFunc, Combiner combiner, int numMapTasks,
+                       Splitter splitter = Splitter()) {
+    using TaskType = StaticMapReduceTask<Input, Key, Value, MapFunc, ReduceFunc, Combiner, Splitter>;
+    return std::make_shared<TaskType>(std::move(mapFunc), std::move(reduceFunc), std::move(combiner), numMapTasks,
+                                      true, std::move(splitter));
+}
+
+}  // namespace mrh
@@ -1,18 +1,34 @@
 #pragma once
 
 #include <any>
+#include <atomic>
+#include <cstdint>
 #include <condition_variable>
+#include <exception>
+#include <functional>
 #include <memory>
+#include <iosfwd>
 #include <mutex>
+#include <optional>
+#include <string>
 #include <vector>
 
 namespace mrh {
 
+class ResultStore;
+
+namespace detail {
+class TaskAwaiter;
+}
+
 /**
  * @brief Base class for tasks with dependency management and optional result caching.
  */
 class Task: public std::enable_shared_from_this<Task> {
 public:
+    /// Receives the result of an asynchronous execution, or the exception that ended it.
+    using Completion = std::function<void(std::any result, std::exception_ptr error)>;
+
     /**
      * @brief Constructs a Task.
      * @param cacheResult If true, caches the result of execution.
@@ -24,13 +40,33 @@ public:
     /**
      * @brief Executes the task.
      *
-     * If caching is enabled, subsequent calls return the cached result.
+     * If caching is enabled, subsequent calls return the cached result until
+     * the task is invalidated. A task that would have to run is not started
+     * once the current CancellationToken has been cancelled.
      *
      * @param threadPool Thread pool for executing dependencies.
      * @return The result as std::any.
+     * @throws OperationCancelled If the task would have to run but the current token is cancelled.
      */
     std::any execute(class ThreadPool& threadPool);
 
+    /**
+     * @brief Executes the task without waiting for other threads.
+     *
+     * The completion receives what execute() would return or throw. With a
+     * cached result it is called right away on the calling thread. If another
+     * execution of the task is in progress, it is queued instead of blocking,
+     * and called by the thread that finishes that execution, with its result
+     * or exception. Otherwise the task is started with runAsyncImpl().
+     *
+     * The task must be owned by a std::shared_ptr and stay alive until the
+     * completion has been called.
+     *
+     * @param threadPool Thread pool for executing dependencies.
+     * @param done Called exactly once.
+     */
+    void executeAsync(class ThreadPool& threadPool, Completion done);
+
     /**
      * @brief Sets the caching mode.
      * @param cacheResult True to cache the result.
@@ -43,6 +79,82 @@ public:
      */
     bool getCacheResult() const;
 
+    /**
+     * @brief Sets the scheduling priority.
+     *
+     * Among ready tasks, the Scheduler dispatches higher priorities first. The
+     * priority also applies to all transitive dependencies, so the work leading
+     * up to this task is preferred as well.
+     *
+     * @param priority The priority; 0 by default.
+     */
+    void setPriority(int priority);
+
+    /**
+     * @brief Returns the scheduling priority.
+     * @return The priority set with setPriority().
+     */
+    int getPriority() const;
+
+    /**
+     * @brief Returns the duration of the last run of this task by a Scheduler.
+     *
+     * The Scheduler uses it to estimate the remaining critical path of later runs.
+     *
+     * @return The wall time in nanoseconds, or 0 if a Scheduler has not run the task yet.
+     */
+    uint64_t getLastRuntime() const;
+
+    /**
+     * @brief Marks the cached result of this task and of all its transitive dependents as stale.
+     *
+     * The next execution recomputes the invalidated tasks, while tasks outside
+     * the invalidated subgraph keep returning their cached results. A task
+     * invalidated while it runs is recomputed again on its next execution.
+     */
+    void invalidate();
+
+    /**
+     * @brief Returns whether the next execution has to run the task.
+     * @return True if caching is disabled, the task has not run yet or it has been invalidated.
+     */
+    bool isDirty() const;
+
+    /**
+     * @brief Sets the key identifying the computation of this task.
+     *
+     * The key stands for the task's logic and parameters, and for a source
+     * task also for the content of its input; a task whose computation or
+     * input changes must get a new key. Together with the keys of all
+     * transitive dependencies it forms the fingerprint under which the result
+     * is persisted in the ResultStore.
+     *
+     * @param cacheKey The key.
+     */
+    void setCacheKey(std::string cacheKey);
+
+    /**
+     * @brief Returns the fingerprint of this task's result.
+     *
+     * The fingerprints of this task and of its dependencies are cached until
+     * setCacheKey() or dependsOn() changes the task or one of its dependencies.
+     *
+     * @return The fingerprint, or nothing if this task or a transitive dependency has no cache key.
+     */
+    std::optional<uint64_t> getFingerprint() const;
+
+    /**
+     * @brief Sets the store in which results are persisted across processes.
+     *
+     * With a store, a caching task that has a fingerprint and a serializable
+     * result first looks its result up in the store and only runs if it is
+     * missing; a computed result is written to the store. Invalidated tasks
+     * skip the lookup on their next execution.
+     *
+     * @param resultStore The store, or nullptr to disable persistence.
+     */
+    void setResultStore(std::shared_ptr<ResultStore> resultStore);
+
     /**
      * @brief Adds a dependency.
      * @param dependency The task this task depends on.
@@ -69,11 +181,69 @@ public:
 
     /**
      * @brief Retrieves the result of the task.
-     * @return The result as std::any.
+     * @return The result of the last completed execution as std::any.
      */
     std::any getResult() const;
 
 protected:
+    friend class Scheduler;
+    friend class detail::TaskAwaiter;
+
+    /**
+     * @brief Executes the task and returns the result as produced by runImpl().
+     *
+     * Unlike execute(), the result is not passed through exportResult(), so
+     * for typed tasks this is a cheap copy of a shared pointer.
+     *
+     * @param threadPool Thread pool for executing dependencies.
+     * @return The stored result.
+     */
+    std::any executeRaw(class ThreadPool& threadPool);
+
+    /**
+     * @brief executeAsync() passing the result as produced by runImpl().
+     *
+     * @param threadPool Thread pool for executing dependencies.
+     * @param done Called exactly once.
+     */
+    void executeRawAsync(class ThreadPool& threadPool, Completion done);
+
+    /**
+     * @brief Retrieves the result as produced by runImpl().
+     * @return The stored result.
+     */
+    std::any getRawResult() const;
+
+    /**
+     * @brief Converts a stored result into the value handed out by execute() and getResult().
+     *
+     * The default returns the stored result unchanged.
+     *
+     * @param raw The stored result.
+     * @return The exported result.
+     */
+    virtual std::any exportResult(std::any raw) const;
+
+    /**
+     * @brief Writes a stored result for the ResultStore.
+     *
+     * The default supports no result type.
+     *
+     * @param raw The stored result.
+     * @param out Stream to write to.
+     * @return False if the result cannot be serialized.
+     */
+    virtual bool serializeResult(const std::any& raw, std::ostream& out) const;
+
+    /**
+     * @brief Reads a stored result written by serializeResult().
+     *
+     * @param in Stream to read from.
+     * @param raw Receives the stored result.
+     * @return False if the result cannot be deserialized.
+     */
+    virtual bool deserializeResult(std::istream& in, std::any& raw) const;
+
     /**
      * @brief The task-specific execution logic.
      *
@@ -84,14 +254,83 @@ protected:
      */
     virtual std::any runImpl(class ThreadPool& threadPool) = 0;
 
+    /**
+     * @brief Starts the task-specific execution logic, reporting its result to a completion.
+     *
+     * Used by executeAsync() and the Scheduler. The default runs runImpl() on
+     * the calling thread. Tasks that wait for other work override it to return
+     * without blocking and complete later, from any thread.
+     *
+     * @param threadPool Thread pool for executing sub-tasks.
+     * @param done Must be called exactly once, with the result or the exception; nothing may be thrown instead.
+     */
+    virtual void runAsyncImpl(class ThreadPool& threadPool, Completion done);
+
 private:
+    /// Lifecycle of the cached result.
+    enum class State {
+        Dirty,    ///< The result is missing or stale.
+        Running,  ///< A thread is computing the result.
+        Clean     ///< The result is up to date.
+    };
+
+    /**
+     * @brief Loads the result from the result store or computes and stores it.
+     *
+     * @param threadPool Thread pool for executing dependencies.
+     * @param lookup False to skip the lookup and recompute.
+     * @return The result.
+     */
+    std::any runOrLoad(class ThreadPool& threadPool, bool lookup);
+
+    /**
+     * @brief Reads the result from the result store.
+     *
+     * @param fingerprint Fingerprint of the result.
+     * @param raw Receives the result.
+     * @return False if the store has no usable entry, including one that fails to deserialize.
+     */
+    bool loadStored(uint64_t fingerprint, std::any& raw) const;
+
+    /**
+     * @brief Writes a result to the result store if it can be serialized.
+     *
+     * @param fingerprint Fingerprint of the result.
+     * @param raw The result.
+     */
+    void storeResult(uint64_t fingerprint, const std::any& raw) const;
+
+    /**
+     * @brief Ends a computation started in State::Running.
+     *
+     * Stores the result, wakes blocked executions and calls the queued completions.
+     *
+     * @param version Version of the task when the computation started.
+     * @param raw The result, ignored if error is set.
+     * @param error The exception that ended the computation, or nullptr.
+     * @return The stored result.
+     */
+    std::any finishRun(uint64_t version, std::any raw, std::exception_ptr error);
+
+    /// Drops the cached fingerprints of this task and of all its transitive dependents.
+    void resetFingerprints();
+
     std::vector<std::shared_ptr<Task>> _dependencies;  ///< Dependencies.
     std::vector<std::weak_ptr<Task>> _dependents;      ///< Dependent tasks.
     std::any _result;                                  ///< Cached result.
-    std::once_flag _onceFlag;                          ///< Ensures single execution if caching.
+    State _state      = State::Dirty;                  ///< State of _result if caching.
+    uint64_t _version = 0;                             ///< Incremented by every invalidation.
+    bool _bypassStore = false;                         ///< Set by invalidation to skip the store lookup.
     bool _cacheResult;                                 ///< Caching flag.
-    mutable std::mutex _mutex;                         ///< Protects _result.
-    std::condition_variable _condVar;                  ///< For synchronizing result access.
+    int _priority = 0;                                 ///< Scheduling priority.
+    std::atomic<uint64_t> _lastRuntime{0};             ///< Last run time under a Scheduler, in nanoseconds.
+    std::optional<std::string> _cacheKey;              ///< Identity of the computation.
+    mutable std::optional<uint64_t> _fingerprint;      ///< Cached result of getFingerprint().
+    mutable bool _fingerprintKnown = false;            ///< Whether _fingerprint is up to date.
+    std::shared_ptr<ResultStore> _resultStore;         ///< Persistent store, if any.
+    mutable std::mutex _mutex;                         ///< Protects the result state and the fingerprint cache.
+    std::condition_variable _condVar;                  ///< Signals the end of a computation.
+    std::vector<Completion> _waiters;                  ///< Asynchronous executions waiting for the computation.
 };
 
 }  // namespace mrh
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "MRHelper/Cancellation.hpp"
+#include "MRHelper/PoolAllocator.hpp"
+#include "MRHelper/ThreadPool.hpp"
+#include "MRHelper/UniqueFunction.hpp"
+
+namespace mrh {
+
+/**
+ * @brief A group of pool tasks that can be joined without spinning.
+ *
+ * Children are submitted to the pool, but the thread calling wait() may claim
+ * and run any child that has not started yet. Once no unstarted children are
+ * left, the waiter blocks on a condition variable until the running ones
+ * finish. The waiter never runs work that does not belong to the group, so
+ * nested groups only grow the stack by their nesting depth.
+ *
+ * Children may add further children to the same group. A child that starts
+ * asynchronous work can keep the group pending until that work completes with
+ * hold() and release().
+ *
+ * Children run with the group's CancellationToken as their current token.
+ * Once it is cancelled, children that have not started are skipped and wait()
+ * throws OperationCancelled.
+ */
+class TaskGroup {
+public:
+    /**
+     * @brief Constructs a TaskGroup.
+     *
+     * @param threadPool Pool the children are submitted to.
+     * @param token Token cancelling the children; by default the current token of the calling thread.
+     * @param cancelOnError If true, the first exception thrown by a child cancels the other children.
+     */
+    explicit TaskGroup(ThreadPool& threadPool, const CancellationToken& token = CancellationToken::current(),
+                       bool cancelOnError = false);
+
+    /// Waits for all children; exceptions are discarded.
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&)            = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    /**
+     * @brief Submits a child task.
+     *
+     * @tparam F Callable type, invoked without arguments.
+     * @param f The function to execute.
+     */
+    template <class F>
+    void run(F&& f);
+
+    /**
+     * @brief Submits a child task that should preferably run on one NUMA node.
+     *
+     * See ThreadPool::postToNode(). The waiter may still claim the child.
+     *
+     * @tparam F Callable type, invoked without arguments.
+     * @param node Index of the node in ThreadPool::getNumNodes(), or ThreadPool::AnyNode.
+     * @param f The function to execute.
+     */
+    template <class F>
+    void runOnNode(size_t node, F&& f);
+
+    /**
+     * @brief Waits until all children, including ones added meanwhile, have finished.
+     *
+     * Rethrows the first exception thrown by a child. The group can be reused afterwards.
+     */
+    void wait();
+
+    /**
+     * @brief Keeps the group pending until a matching release().
+     *
+     * Must be called by a running child (or while wait() cannot return for
+     * another reason), so that the group cannot finish in between.
+     */
+    void hold();
+
+    /**
+     * @brief Ends a hold().
+     * @param error Exception to record as if a child had thrown it, or nullptr.
+     */
+    void release(std::exception_ptr error = nullptr);
+
+    /// Skips all children that have not started yet; wait() then throws OperationCancelled.
+    void cancel();
+
+    /// Returns the token the children run with.
+    const CancellationToken& getToken() const { return _token; }
+
+private:
+    /// A child task that is run by whichever thread claims it first.
+    struct Child {
+        UniqueFunction func;               ///< The child's work.
+        std::atomic<bool> claimed{false};  ///< Set by the thread that runs the child.
+    };
+
+    /**
+     * @brief Registers a child and submits it to the pool.
+     * @param child The child.
+     * @param node Node to submit the child to, or ThreadPool::AnyNode.
+     */
+    void submit(std::shared_ptr<Child> child, size_t node = ThreadPool::AnyNode);
+
+    /**
+     * @brief Runs a claimed child and records its completion.
+     * @param child The child.
+     */
+    void execute(Child& child);
+
+    /**
+     * @brief Records the exception of a child and cancels the group if requested.
+     * @param error The exception.
+     */
+    void fail(std::exception_ptr error);
+
+    /// Decrements the pending count, waking the waiter when it reaches zero.
+    void finish();
+
+    ThreadPool& _threadPool;                         ///< Pool the children are submitted to.
+    CancellationToken _token;                        ///< Token the children run with; owned by the group.
+    bool _cancelOnError;                             ///< Whether an exception cancels _token.
+    std::vector<std::shared_ptr<Child>> _unclaimed;  ///< Children the waiter may still claim.
+    std::atomic<size_t> _pending{0};                 ///< Children submitted but not finished.
+    std::exception_ptr _error;                       ///< First exception thrown by a child.
+    std::mutex _mutex;                               ///< Protects _unclaimed and _error.
+    std::condition_variable _condition;              ///< Signals new children and completion.
+};
+
+template <class F>
+void TaskGroup::run(F&& f) {
+    auto child  = std::allocate_shared<Child>(PoolAllocator<Child>());
+    child->func = std::forward<F>(f);
+    submit(std::move(child));
+}
+
+template <class F>
+void TaskGroup::runOnNode(size_t node, F&& f) {
+    auto child  = std::allocate_shared<Child>(PoolAllocator<Child>());
+    child->func = std::forward<F>(f);
+    submit(std::move(child), node);
+}
+
+}  // namespace mrh
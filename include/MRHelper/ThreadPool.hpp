@@ -1,31 +1,128 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <future>
+#include <iterator>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <queue>
 #include <thread>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
+#include "MRHelper/PoolAllocator.hpp"
+#include "MRHelper/Topology.hpp"
+#include "MRHelper/UniqueFunction.hpp"
+
 namespace mrh {
 
 /**
  * @brief A thread pool based on the producer-consumer pattern.
+ *
+ * In WorkStealing mode (default) every worker owns a deque. Tasks enqueued from
+ * a worker go to its own deque and are popped LIFO; tasks enqueued from other
+ * threads go to a global injection queue. Idle workers take from the injection
+ * queue and steal from the other workers' deques. In SharedQueue mode all
+ * threads share a single FIFO queue.
+ *
+ * NumaAware mode is WorkStealing with the workers pinned to CPUs and spread
+ * evenly over the NUMA nodes of a Topology. Every node has its own injection
+ * queue, and an idle worker looks for work on its own node (own deque, node
+ * queue, deques of the node's other workers) before it steals across nodes.
+ * Memory a job allocates and first writes is placed by the operating system
+ * on the node the job runs on, so work submitted with postToNode() keeps its
+ * buffers local. On a single-node machine the mode only adds the pinning.
+ *
+ * Any mode can be made elastic by constructing the pool with Elasticity
+ * bounds. An elastic pool starts minThreads workers. A worker that is about
+ * to block, e.g. on I/O or on work running elsewhere, opens a
+ * blockingRegion(); if fewer than minThreads workers are left running, a
+ * compensating worker is started, up to maxThreads. Workers above minThreads
+ * that stay idle for the idle timeout retire. getStats() reports the pool size
+ * and the number of started and retired workers.
  */
 class ThreadPool {
 public:
+    /// Queueing strategy of the pool.
+    enum class Mode {
+        SharedQueue,   ///< One queue and one lock shared by all threads.
+        WorkStealing,  ///< Per-worker deques with stealing and a global injection queue.
+        NumaAware,     ///< WorkStealing with pinned workers and one queue group per NUMA node.
+    };
+
+    /// Node argument of postToNode() that leaves the choice to the pool.
+    static constexpr size_t AnyNode = static_cast<size_t>(-1);
+
+    /// Bounds of an elastic pool.
+    struct Elasticity {
+        size_t minThreads = std::thread::hardware_concurrency();  ///< Workers kept running outside blocking regions.
+        size_t maxThreads = 4 * minThreads;                        ///< Upper bound on workers, blocked ones included.
+        std::chrono::milliseconds idleTimeout{1000};               ///< Idle time after which a surplus worker retires.
+    };
+
+    /// Snapshot of the size of the pool.
+    struct Stats {
+        size_t numThreads = 0;  ///< Running worker threads.
+        size_t numBlocked = 0;  ///< Workers inside a blocking region.
+        uint64_t spawned  = 0;  ///< Workers started after construction.
+        uint64_t retired  = 0;  ///< Workers that retired after being idle.
+    };
+
+    /**
+     * @brief Scope in which a worker announces that it may block.
+     *
+     * Obtained from blockingRegion(); the announcement ends when the scope is destroyed.
+     */
+    class BlockingRegion {
+    public:
+        ~BlockingRegion();
+
+        BlockingRegion(const BlockingRegion&)            = delete;
+        BlockingRegion& operator=(const BlockingRegion&) = delete;
+
+    private:
+        friend class ThreadPool;
+
+        explicit BlockingRegion(ThreadPool* pool) : _pool(pool) {}
+
+        ThreadPool* _pool;  ///< Pool notified at the end of the region, or nullptr.
+    };
+
     /**
      * @brief Constructs a ThreadPool.
      * @param numThreads Number of worker threads.
+     * @param mode Queueing strategy; NumaAware uses Topology::system().
      */
-    explicit ThreadPool(size_t numThreads);
+    explicit ThreadPool(size_t numThreads, Mode mode = Mode::WorkStealing);
+
+    /**
+     * @brief Constructs a NumaAware ThreadPool for a given topology.
+     * @param numThreads Number of worker threads.
+     * @param topology Nodes and CPUs to place the workers on.
+     */
+    ThreadPool(size_t numThreads, const Topology& topology);
+
+    /**
+     * @brief Constructs an elastic ThreadPool.
+     * @param elasticity Bounds of the pool size; minThreads is raised to at least 1 and maxThreads to minThreads.
+     * @param mode Queueing strategy; NumaAware uses Topology::system().
+     */
+    explicit ThreadPool(const Elasticity& elasticity, Mode mode = Mode::WorkStealing);
 
     ~ThreadPool();
 
     /**
      * @brief Enqueues a task for execution.
      *
+     * Arguments are stored by value and passed to f as lvalues, as with std::bind.
+     *
      * @tparam F Function type.
      * @tparam Args Argument types.
      * @param f The function to execute.
@@ -35,35 +132,314 @@ public:
     template <class F, class... Args>
     auto enqueue(F&& f, Args&&... args) -> std::future<typename std::invoke_result_t<F, Args...>>;
 
+    /**
+     * @brief Submits a task without creating a future.
+     *
+     * Small callables are queued without any allocation. The task must not
+     * throw; an escaping exception calls std::terminate.
+     *
+     * @tparam F Function type, invocable without arguments.
+     * @param f The function to execute.
+     */
+    template <class F>
+    void post(F&& f);
+
+    /**
+     * @brief Submits a task without creating a future, preferably to the workers of one node.
+     *
+     * The task goes to the node's injection queue; workers of other nodes only
+     * take it when they have run out of work. Pools that are not NumaAware
+     * ignore the node.
+     *
+     * @tparam F Function type, invocable without arguments.
+     * @param node Index of the node in getNumNodes(), or AnyNode.
+     * @param f The function to execute.
+     */
+    template <class F>
+    void postToNode(size_t node, F&& f);
+
+    /**
+     * @brief Enqueues a range of callables, taking the queue lock once.
+     *
+     * @tparam It Input iterator over callables invocable without arguments.
+     * @param first Beginning of the range.
+     * @param last End of the range.
+     * @return One future per callable, in range order.
+     */
+    template <class It>
+    auto enqueueBatch(It first, It last)
+        -> std::vector<std::future<std::invoke_result_t<typename std::iterator_traits<It>::value_type&>>>;
+
     /**
      * @brief Attempts to execute one task from the queue in the current thread.
      *
+     * A worker of this pool prefers its own deque; other threads take from the
+     * injection queue first and then steal.
+     *
      * @return True if a task was executed, false otherwise.
      */
     bool tryExecuteOne();
 
+    /**
+     * @brief Announces that the calling thread may block until the returned scope ends.
+     *
+     * On a worker of an elastic pool, starts a compensating worker if fewer
+     * than minThreads workers would be left running outside blocking regions.
+     * Nested regions count once. On any other thread it does nothing, so
+     * library code may call it around every potentially blocking wait.
+     *
+     * @return The scope of the region.
+     */
+    [[nodiscard]] static BlockingRegion blockingRegion();
+
+    /**
+     * @brief Returns the number of worker threads.
+     * @return The number of running worker threads; for an elastic pool it changes over time.
+     */
+    size_t getNumThreads() const;
+
+    /**
+     * @brief Returns whether the pool was constructed with Elasticity bounds.
+     * @return True for an elastic pool.
+     */
+    bool isElastic() const;
+
+    /**
+     * @brief Returns the current size of the pool and its counters since construction.
+     * @return A snapshot of the counters.
+     */
+    Stats getStats() const;
+
+    /**
+     * @brief Returns the queueing strategy.
+     * @return The mode the pool was constructed with.
+     */
+    Mode getMode() const;
+
+    /**
+     * @brief Returns the number of NUMA nodes the workers are spread over.
+     * @return The number of nodes of the topology in NumaAware mode, otherwise 1.
+     */
+    size_t getNumNodes() const;
+
+    /**
+     * @brief Returns the node of the calling thread.
+     * @return The node index if the caller is a worker of a NumaAware pool, otherwise AnyNode.
+     */
+    size_t getCurrentNode() const;
+
 private:
-    std::vector<std::thread> _workers;         ///< Worker threads.
-    std::queue<std::function<void()>> _tasks;  ///< Task queue.
-    std::mutex _queueMutex;                    ///< Protects _tasks.
-    std::condition_variable _condition;        ///< Notifies worker threads.
-    bool _stop;                                ///< Indicates if the pool is stopping.
+    friend class TaskGroup;
+
+    using Job = UniqueFunction;
+
+    /**
+     * @brief Wraps a callable into a job that fulfils a pooled promise.
+     *
+     * @param func The callable.
+     * @param res Receives the future of the job's result.
+     * @return The job.
+     */
+    template <class R, class Fn>
+    static Job makeJob(Fn&& func, std::future<R>& res);
+
+    /**
+     * @brief Creates the queues and worker slots and starts the first workers.
+     *
+     * @param numSlots Maximum number of worker threads.
+     * @param numThreads Number of worker threads to start.
+     * @param topology Nodes to spread the workers over in NumaAware mode.
+     */
+    void start(size_t numSlots, size_t numThreads, const Topology& topology);
+
+    /**
+     * @brief Starts a worker thread in a free slot; requires _queueMutex.
+     * @param slot Index of the slot.
+     */
+    void spawn(size_t slot);
+
+    /**
+     * @brief Waits for work on a condition variable, retiring a surplus worker of an elastic pool.
+     *
+     * @param index Index of the calling worker.
+     * @param condition The condition variable.
+     * @param lock Lock on _queueMutex.
+     * @param ready Predicate that ends the wait.
+     * @return False if the worker has retired and must exit.
+     */
+    template <class Predicate>
+    bool sleep(size_t index, std::condition_variable& condition, std::unique_lock<std::mutex>& lock, Predicate ready);
+
+    /// Counts the calling worker as blocked, starting a compensating worker if needed.
+    void enterBlocking();
+
+    /// Ends the blocked state of the calling worker.
+    void leaveBlocking();
+
+    /// Deque owned by one worker in WorkStealing and NumaAware modes.
+    struct alignas(64) WorkerQueue {
+        std::mutex mutex;      ///< Protects jobs.
+        std::deque<Job> jobs;  ///< Owner pushes and pops at the back, thieves take from the front.
+    };
+
+    /// Injection queue and workers of one NUMA node (NumaAware mode).
+    struct alignas(64) NodeQueue {
+        std::mutex mutex;                 ///< Protects jobs.
+        std::queue<Job> jobs;             ///< Jobs submitted to the node.
+        std::atomic<size_t> size{0};      ///< Size of jobs, readable without the lock.
+        std::vector<size_t> workers;      ///< Indices of the node's workers.
+        std::condition_variable wakeup;   ///< Notifies the node's sleeping workers.
+        std::atomic<size_t> sleepers{0};  ///< Workers of the node waiting on wakeup.
+    };
+
+    /**
+     * @brief Submits a type-erased job.
+     * @param job The job.
+     * @param node Node whose injection queue receives the job in NumaAware mode, or AnyNode.
+     */
+    void push(Job&& job, size_t node = AnyNode);
+
+    /**
+     * @brief Submits several jobs under a single lock.
+     * @param jobs The jobs; left empty.
+     */
+    void pushBatch(std::vector<Job>& jobs);
+
+    /**
+     * @brief Takes the next job for the calling thread.
+     *
+     * @param job Receives the job.
+     * @return True if a job was taken.
+     */
+    bool pop(Job& job);
+
+    /**
+     * @brief Takes the next job in NumaAware mode, searching the caller's node first.
+     *
+     * @param self Index of the calling worker, or the number of worker slots for external threads.
+     * @param job Receives the job.
+     * @return True if a job was taken.
+     */
+    bool popNuma(size_t self, Job& job);
+
+    /**
+     * @brief Takes a job from another worker's deque.
+     *
+     * @param self Index of the calling worker, or the number of worker slots for external threads.
+     * @param job Receives the job.
+     * @return True if a job was stolen.
+     */
+    bool steal(size_t self, Job& job);
+
+    /**
+     * @brief Takes the oldest job of one worker's deque.
+     *
+     * @param victim Index of the worker.
+     * @param job Receives the job.
+     * @return True if a job was stolen.
+     */
+    bool stealFrom(size_t victim, Job& job);
+
+    /**
+     * @brief Wakes a sleeping worker after jobs were queued.
+     *
+     * @param node Node whose workers are woken first in NumaAware mode.
+     * @param all Wake every sleeping worker instead of one.
+     */
+    void wake(size_t node, bool all);
+
+    /**
+     * @brief Main loop of a worker thread.
+     * @param index Index of the worker.
+     */
+    void workerLoop(size_t index);
+
+    /**
+     * @brief Returns the index of the calling thread if it is a worker of this pool.
+     * @return The worker index, or the number of worker slots for other threads.
+     */
+    size_t currentWorker() const;
+
+    std::vector<std::thread> _workers;                  ///< Worker thread of every slot; joinable once started.
+    std::vector<bool> _running;                         ///< Whether a slot's worker runs (under _queueMutex).
+    std::vector<size_t> _cpus;                          ///< CPU every slot's worker is pinned to (NumaAware mode).
+    std::vector<std::unique_ptr<WorkerQueue>> _locals;  ///< Per-worker deques (all but SharedQueue mode).
+    std::vector<std::unique_ptr<NodeQueue>> _nodes;     ///< Per-node queues (NumaAware mode).
+    std::vector<size_t> _workerNodes;                   ///< Node of every worker (NumaAware mode).
+    std::atomic<size_t> _nextNode{0};                   ///< Node receiving the next external job (NumaAware mode).
+    std::queue<Job> _tasks;                             ///< Shared queue, or injection queue in WorkStealing mode.
+    std::mutex _queueMutex;                             ///< Protects _tasks and the elastic state.
+    std::condition_variable _condition;                 ///< Notifies worker threads.
+    std::atomic<size_t> _injected{0};                   ///< Size of _tasks, readable without the lock.
+    std::atomic<size_t> _pending{0};                    ///< Jobs queued anywhere.
+    std::atomic<size_t> _sleepers{0};                   ///< Sleeping workers (all but SharedQueue mode).
+    std::atomic<size_t> _numThreads{0};                 ///< Running workers.
+    std::atomic<size_t> _numBlocked{0};                 ///< Workers inside a blocking region.
+    std::atomic<uint64_t> _spawned{0};                  ///< Workers started after construction.
+    std::atomic<uint64_t> _retired{0};                  ///< Workers that retired.
+    std::optional<Elasticity> _elasticity;              ///< Bounds of an elastic pool.
+    Mode _mode;                                         ///< Queueing strategy.
+    std::atomic<bool> _stop;                            ///< Indicates if the pool is stopping.
 };
 
+template <class R, class Fn>
+ThreadPool::Job ThreadPool::makeJob(Fn&& func, std::future<R>& res) {
+    // The promise's shared state comes from the pooled allocator, and the job
+    // (promise + callable) usually fits UniqueFunction's inline buffer.
+    std::promise<R> promise(std::allocator_arg, PoolAllocator<char>());
+    res = promise.get_future();
+    return [promise = std::move(promise), func = std::forward<Fn>(func)]() mutable {
+        try {
+            if constexpr (std::is_void_v<R>) {
+                func();
+                promise.set_value();
+            } else {
+                promise.set_value(func());
+            }
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+        }
+    };
+}
+
 template <class F, class... Args>
 auto ThreadPool::enqueue(F&& f, Args&&... args) -> std::future<typename std::invoke_result_t<F, Args...>> {
     using return_type = typename std::invoke_result_t<F, Args...>;
-    auto task =
-        std::make_shared<std::packaged_task<return_type()>>(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-    std::future<return_type> res = task->get_future();
-    {
-        std::unique_lock<std::mutex> lock(_queueMutex);
-        if (_stop)
-            throw std::runtime_error("enqueue on stopped ThreadPool");
-        _tasks.emplace([task]() { (*task)(); });
+    std::future<return_type> res;
+    if constexpr (sizeof...(Args) == 0) {
+        push(makeJob<return_type>(std::forward<F>(f), res));
+    } else {
+        push(makeJob<return_type>(
+            [f = std::forward<F>(f), args = std::make_tuple(std::forward<Args>(args)...)]() mutable -> return_type {
+                return std::apply(f, args);
+            },
+            res));
     }
-    _condition.notify_one();
     return res;
 }
 
+template <class F>
+void ThreadPool::post(F&& f) {
+    push(Job(std::forward<F>(f)));
+}
+
+template <class F>
+void ThreadPool::postToNode(size_t node, F&& f) {
+    push(Job(std::forward<F>(f)), node);
+}
+
+template <class It>
+auto ThreadPool::enqueueBatch(It first, It last)
+    -> std::vector<std::future<std::invoke_result_t<typename std::iterator_traits<It>::value_type&>>> {
+    using return_type = std::invoke_result_t<typename std::iterator_traits<It>::value_type&>;
+    std::vector<std::future<return_type>> futures;
+    std::vector<Job> jobs;
+    for (; first != last; ++first) {
+        futures.emplace_back();
+        jobs.push_back(makeJob<return_type>(*first, futures.back()));
+    }
+    pushBatch(jobs);
+    return futures;
+}
+
 }  // namespace mrh
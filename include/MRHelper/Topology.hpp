@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace mrh {
+
+/**
+ * @brief The NUMA nodes of a machine and the CPUs that belong to them.
+ *
+ * On Linux the topology is read from /sys/devices/system/node and restricted
+ * to the CPUs the process may run on; on Windows it comes from the NUMA API.
+ * Where neither is available, or the machine has a single node, it describes
+ * one node holding every CPU, so topology-aware code degrades to its
+ * single-node behaviour.
+ */
+class Topology {
+public:
+    /// A NUMA node.
+    struct Node {
+        size_t id;                 ///< Node number assigned by the operating system.
+        std::vector<size_t> cpus;  ///< CPUs of the node, ascending.
+    };
+
+    /// Constructs a topology with a single node whose CPUs are unknown.
+    Topology();
+
+    /**
+     * @brief Constructs a topology from a list of nodes.
+     * @param nodes The nodes; nodes without CPUs are dropped. If none remain, a single node is used.
+     */
+    explicit Topology(std::vector<Node> nodes);
+
+    /**
+     * @brief Reads a topology from a directory laid out like /sys/devices/system/node.
+     *
+     * Every `node<N>` subdirectory contributes a node whose CPUs are listed in
+     * its `cpulist` file. Memory-only nodes and unreadable entries are skipped.
+     *
+     * @param directory The directory.
+     * @return The topology, with a single node if no node was found.
+     */
+    static Topology fromSysfs(const std::filesystem::path& directory);
+
+    /**
+     * @brief Returns the topology of this machine.
+     *
+     * Detected on first use.
+     *
+     * @return The topology.
+     */
+    static const Topology& system();
+
+    /**
+     * @brief Parses a Linux CPU list such as "0-3,8,10-11".
+     * @param list The list.
+     * @return The CPUs, ascending; malformed ranges are skipped.
+     */
+    static std::vector<size_t> parseCpuList(const std::string& list);
+
+    /**
+     * @brief Restricts the calling thread to one CPU.
+     * @param cpu The CPU.
+     * @return False if the platform does not support affinity or the CPU is not available.
+     */
+    static bool pinCurrentThread(size_t cpu);
+
+    /// Returns the nodes, at least one.
+    const std::vector<Node>& getNodes() const { return _nodes; }
+
+    /// Returns the number of nodes, at least one.
+    size_t getNumNodes() const { return _nodes.size(); }
+
+private:
+    std::vector<Node> _nodes;  ///< Nodes with at least one CPU, or a single node.
+};
+
+}  // namespace mrh
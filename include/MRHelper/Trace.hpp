@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * @brief Non-zero if the library records execution traces.
+ *
+ * Set by the MRHELPER_TRACING CMake option. When zero, every MRH_TRACE_*
+ * macro expands to nothing and the instrumentation has no cost.
+ */
+#ifndef MRHELPER_TRACING
+#define MRHELPER_TRACING 0
+#endif
+
+namespace mrh {
+
+/**
+ * @brief Process-wide recorder of execution trace events.
+ *
+ * Every thread appends to its own buffer without locking; only the first
+ * event of a thread takes a lock to register the buffer. When a thread
+ * exits, its buffer and recorded events are kept and handed to the next
+ * thread that starts recording, which then shares its row in the trace.
+ * Events can be exported as Chrome trace JSON, which chrome://tracing and
+ * Perfetto open.
+ *
+ * The library records pool jobs and their queueing delay, the depth of the
+ * pool queues, task executions, blocking in TaskGroup::wait() and the phases
+ * of MapReduceTask. Applications may add their own events with the MRH_TRACE_*
+ * macros. Names and categories must be string literals or otherwise outlive
+ * the trace.
+ */
+class Tracer {
+public:
+    /// True if tracing is compiled in.
+    static constexpr bool Enabled = MRHELPER_TRACING != 0;
+
+    /// Kind of an event, with the Chrome trace phase as its value.
+    enum class Phase : char {
+        Begin    = 'B',  ///< Start of a span.
+        End      = 'E',  ///< End of the innermost open span of the thread.
+        Complete = 'X',  ///< A span with a known start and duration.
+        Instant  = 'i',  ///< A point in time.
+        Counter  = 'C',  ///< A sample of a counter.
+    };
+
+    /// A recorded event.
+    struct Event {
+        const char* name;      ///< Name of the event.
+        const char* category;  ///< Category, such as "pool" or "mapreduce".
+        const char* argName;   ///< Name of the argument, or nullptr for none.
+        int64_t argValue;      ///< Value of the argument.
+        uint64_t timestamp;    ///< Start time in nanoseconds, see now().
+        uint64_t duration;     ///< Duration in nanoseconds of Complete events.
+        Phase phase;           ///< Kind of the event.
+    };
+
+    /**
+     * @brief Records an event of the calling thread at the current time.
+     *
+     * Does nothing if tracing is compiled out.
+     *
+     * @param phase Kind of the event.
+     * @param name Name of the event.
+     * @param category Category of the event.
+     * @param argName Name of an argument shown with the event, or nullptr; for counters the series name.
+     * @param argValue Value of the argument.
+     */
+    static void record(Phase phase, const char* name, const char* category, const char* argName = nullptr,
+                       int64_t argValue = 0);
+
+    /**
+     * @brief Records a span that has already ended.
+     *
+     * @param name Name of the span.
+     * @param category Category of the span.
+     * @param start Start time, see now().
+     * @param end End time, see now().
+     */
+    static void recordComplete(const char* name, const char* category, uint64_t start, uint64_t end);
+
+    /// Returns the time in nanoseconds since the tracer was first used.
+    static uint64_t now();
+
+    /// Returns the number of recorded events.
+    static size_t getNumEvents();
+
+    /**
+     * @brief Writes all recorded events as Chrome trace JSON.
+     *
+     * May run while other threads record; events recorded meanwhile may or
+     * may not be included.
+     *
+     * @param out Stream to write to.
+     */
+    static void writeChromeTrace(std::ostream& out);
+
+    /**
+     * @brief Discards all recorded events.
+     *
+     * Must not run while other threads record.
+     */
+    static void clear();
+
+    /// Records a span covering the lifetime of the object.
+    class Scope {
+    public:
+        Scope(const char* name, const char* category) : _name(name), _category(category) {
+            record(Phase::Begin, name, category);
+        }
+
+        ~Scope() { record(Phase::End, _name, _category); }
+
+        Scope(const Scope&)            = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* _name;      ///< Name of the span.
+        const char* _category;  ///< Category of the span.
+    };
+};
+
+}  // namespace mrh
+
+#define MRH_TRACE_CONCAT_IMPL(a, b) a##b
+#define MRH_TRACE_CONCAT(a, b) MRH_TRACE_CONCAT_IMPL(a, b)
+
+#if MRHELPER_TRACING
+/// Records a span from this point to the end of the enclosing scope.
+#define MRH_TRACE_SCOPE(name, category) \
+    ::mrh::Tracer::Scope MRH_TRACE_CONCAT(mrhTraceScope, __LINE__)(name, category)
+/// Opens a span; must be closed by MRH_TRACE_END on the same thread.
+#define MRH_TRACE_BEGIN(name, category) ::mrh::Tracer::record(::mrh::Tracer::Phase::Begin, name, category)
+/// Closes the span opened by MRH_TRACE_BEGIN.
+#define MRH_TRACE_END(name, category) ::mrh::Tracer::record(::mrh::Tracer::Phase::End, name, category)
+/// Records a point in time.
+#define MRH_TRACE_INSTANT(name, category) ::mrh::Tracer::record(::mrh::Tracer::Phase::Instant, name, category)
+/// Records a sample of a counter.
+#define MRH_TRACE_COUNTER(name, value) \
+    ::mrh::Tracer::record(::mrh::Tracer::Phase::Counter, name, "counter", "value", static_cast<int64_t>(value))
+#else
+#define MRH_TRACE_SCOPE(name, category) ((void)0)
+#define MRH_TRACE_BEGIN(name, category) ((void)0)
+#define MRH_TRACE_END(name, category) ((void)0)
+#define MRH_TRACE_INSTANT(name, category) ((void)0)
+#define MRH_TRACE_COUNTER(name, value) ((void)0)
+#endif
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <any>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "MRHelper/ResultStore.hpp"
+#include "MRHelper/Task.hpp"
+
+namespace mrh {
+
+/**
+ * @brief Shared, immutable result of a task.
+ *
+ * Copying a Result only copies a shared pointer; the value itself is never
+ * copied after it has been produced.
+ *
+ * @tparam T Type of the value.
+ */
+template <typename T>
+class Result {
+public:
+    /// Constructs an empty result.
+    Result() = default;
+
+    /**
+     * @brief Constructs a result sharing the given value.
+     * @param value The value.
+     */
+    explicit Result(std::shared_ptr<const T> value) : _value(std::move(value)) {}
+
+    /**
+     * @brief Returns a borrowed reference to the value.
+     * @throws std::logic_error If the result is empty.
+     */
+    const T& get() const {
+        if (!_value)
+            throw std::logic_error("Result: empty result");
+        return *_value;
+    }
+
+    const T& operator*() const { return get(); }
+
+    const T* operator->() const { return &get(); }
+
+    /// Returns true if the result holds a value.
+    explicit operator bool() const { return static_cast<bool>(_value); }
+
+    /// Returns the shared pointer to the value.
+    const std::shared_ptr<const T>& share() const { return _value; }
+
+private:
+    std::shared_ptr<const T> _value;  ///< The shared value.
+};
+
+template <typename T>
+class TypedTask;
+
+/**
+ * @brief Executes a dependency and returns its result as Result<T>.
+ *
+ * Results of TypedTask<T> are shared without copying. For any other task the
+ * std::any returned by Task::execute() is moved into a new shared value.
+ *
+ * @tparam T Expected result type.
+ * @param task The task to execute.
+ * @param threadPool Thread pool for executing dependencies.
+ * @return The shared result.
+ * @throws std::bad_any_cast If the task produces a different type.
+ */
+template <typename T>
+Result<T> resultOf(const std::shared_ptr<Task>& task, ThreadPool& threadPool) {
+    if (auto typed = std::dynamic_pointer_cast<TypedTask<T>>(task))
+        return typed->executeTyped(threadPool);
+    std::any value = task->execute(threadPool);
+    return Result<T>(std::make_shared<const T>(std::any_cast<T>(std::move(value))));
+}
+
+/**
+ * @brief Typed access to the results of a task's dependencies.
+ */
+class TaskInputs {
+public:
+    /**
+     * @brief Constructs TaskInputs.
+     *
+     * @param dependencies The dependencies of the task.
+     * @param threadPool Thread pool for executing dependencies.
+     */
+    TaskInputs(const std::vector<std::shared_ptr<Task>>& dependencies, ThreadPool& threadPool)
+        : _dependencies(dependencies), _threadPool(threadPool) {}
+
+    /// Returns the number of dependencies.
+    size_t size() const { return _dependencies.size(); }
+
+    /**
+     * @brief Returns the result of the i-th dependency.
+     *
+     * @tparam T Expected result type.
+     * @param i Index of the dependency.
+     * @return The shared result.
+     */
+    template <typename T>
+    Result<T> get(size_t i) const {
+        return resultOf<T>(_dependencies.at(i), _threadPool);
+    }
+
+    /**
+     * @brief Returns the result of the i-th dependency as std::any.
+     * @param i Index of the dependency.
+     * @return A copy of the result.
+     */
+    std::any getAny(size_t i) const { return _dependencies.at(i)->execute(_threadPool); }
+
+private:
+    const std::vector<std::shared_ptr<Task>>& _dependencies;  ///< Dependencies of the task.
+    ThreadPool& _threadPool;                                  ///< Pool for executing dependencies.
+};
+
+/**
+ * @brief A task producing a value of a known type.
+ *
+ * The result is stored once as std::shared_ptr<const T> and handed out by
+ * executeTyped()/getTypedResult() without copying. execute()/getResult() still
+ * return a std::any holding a copy of the value, so untyped consumers such as
+ * SimpleTask keep working.
+ *
+ * @tparam T Type of the result.
+ */
+template <typename T>
+class TypedTask: public Task {
+public:
+    /// Type alias for the task function.
+    using TaskFunction = std::function<T(const TaskInputs&)>;
+
+    /**
+     * @brief Constructs a TypedTask.
+     *
+     * @param func The function to execute; may be empty if runTyped() is overridden.
+     * @param cacheResult Whether to cache the result.
+     */
+    explicit TypedTask(TaskFunction func = {}, bool cacheResult = true) : Task(cacheResult), _func(std::move(func)) {}
+
+    /**
+     * @brief Executes the task and shares its result.
+     *
+     * @param threadPool Thread pool for executing dependencies.
+     * @return The shared result.
+     */
+    Result<T> executeTyped(ThreadPool& threadPool) {
+        return Result<T>(std::any_cast<std::shared_ptr<const T>>(executeRaw(threadPool)));
+    }
+
+    /**
+     * @brief Shares the cached result.
+     * @return The shared result, empty if the task has not run.
+     */
+    Result<T> getTypedResult() const {
+        std::any raw = getRawResult();
+        if (!raw.has_value())
+            return Result<T>();
+        return Result<T>(std::any_cast<std::shared_ptr<const T>>(std::move(raw)));
+    }
+
+protected:
+    /**
+     * @brief The typed execution logic.
+     *
+     * The default calls the task function with typed access to the dependencies.
+     *
+     * @param threadPool Thread pool for executing dependencies.
+     * @return The shared result.
+     */
+    virtual Result<T> runTyped(ThreadPool& threadPool) {
+        return Result<T>(std::make_shared<const T>(_func(TaskInputs(getDependencies(), threadPool))));
+    }
+
+    std::any runImpl(ThreadPool& threadPool) final { return runTyped(threadPool).share(); }
+
+    std::any exportResult(std::any raw) const override {
+        if (!raw.has_value())
+            return raw;
+        return std::any(*std::any_cast<const std::shared_ptr<const T>&>(raw));
+    }
+
+    bool serializeResult(const std::any& raw, std::ostream& out) const override {
+        return detail::writeResult(*std::any_cast<const std::shared_ptr<const T>&>(raw), out);
+    }
+
+    bool deserializeResult(std::istream& in, std::any& raw) const override {
+        if constexpr (std::is_default_constructible_v<T>) {
+            T value{};
+            if (!detail::readResult(in, value))
+                return false;
+            raw = std::shared_ptr<const T>(std::make_shared<const T>(std::move(value)));
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+private:
+    TaskFunction _func;  ///< User-supplied function.
+};
+
+}  // namespace mrh
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace mrh {
+
+/**
+ * @brief Move-only, type-erased `void()` callable with small-buffer optimization.
+ *
+ * Callables up to InlineSize bytes that are nothrow move constructible are
+ * stored inside the object, so wrapping them does not allocate. Larger
+ * callables are stored on the heap. Unlike std::function, move-only callables
+ * (e.g. lambdas capturing a std::promise) are supported.
+ */
+class UniqueFunction {
+public:
+    /// Size of the inline buffer in bytes.
+    static constexpr size_t InlineSize = 64;
+
+    /// Constructs an empty function.
+    UniqueFunction() noexcept = default;
+
+    /// Constructs an empty function.
+    UniqueFunction(std::nullptr_t) noexcept {}
+
+    /**
+     * @brief Wraps a callable.
+     *
+     * @tparam F Callable type, invocable without arguments.
+     * @param f The callable.
+     */
+    template <class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, UniqueFunction> &&
+                                                !std::is_same_v<std::decay_t<F>, std::nullptr_t>>>
+    UniqueFunction(F&& f) {
+        using Fn = std::decay_t<F>;
+        if constexpr (fitsInline<Fn>()) {
+            ::new (static_cast<void*>(_storage)) Fn(std::forward<F>(f));
+            _vtable = &InlineOps<Fn>::vtable;
+        } else {
+            *reinterpret_cast<Fn**>(_storage) = new Fn(std::forward<F>(f));
+            _vtable                           = &HeapOps<Fn>::vtable;
+        }
+    }
+
+    UniqueFunction(UniqueFunction&& other) noexcept { moveFrom(other); }
+
+    UniqueFunction& operator=(UniqueFunction&& other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    UniqueFunction& operator=(std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+
+    UniqueFunction(const UniqueFunction&)            = delete;
+    UniqueFunction& operator=(const UniqueFunction&) = delete;
+
+    ~UniqueFunction() { reset(); }
+
+    /// Invokes the wrapped callable.
+    void operator()() {
+        if (!_vtable)
+            throw std::bad_function_call();
+        _vtable->invoke(_storage);
+    }
+
+    /// Returns true if a callable is wrapped.
+    explicit operator bool() const noexcept { return _vtable != nullptr; }
+
+    /**
+     * @brief Returns true if callables of type F are stored without allocating.
+     * @tparam F Callable type.
+     */
+    template <class F>
+    static constexpr bool fitsInline() {
+        return sizeof(F) <= InlineSize && alignof(F) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible_v<F>;
+    }
+
+private:
+    struct VTable {
+        void (*invoke)(void* storage);
+        void (*move)(void* dst, void* src) noexcept;  ///< Move-constructs dst from src and destroys src.
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template <class Fn>
+    struct InlineOps {
+        static void invoke(void* storage) { (*static_cast<Fn*>(storage))(); }
+        static void move(void* dst, void* src) noexcept {
+            ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+            static_cast<Fn*>(src)->~Fn();
+        }
+        static void destroy(void* storage) noexcept { static_cast<Fn*>(storage)->~Fn(); }
+        static constexpr VTable vtable{&invoke, &move, &destroy};
+    };
+
+    template <class Fn>
+    struct HeapOps {
+        static void invoke(void* storage) { (**static_cast<Fn**>(storage))(); }
+        static void move(void* dst, void* src) noexcept { *static_cast<Fn**>(dst) = *static_cast<Fn**>(src); }
+        static void destroy(void* storage) noexcept { delete *static_cast<Fn**>(storage); }
+        static constexpr VTable vtable{&invoke, &move, &destroy};
+    };
+
+    void moveFrom(UniqueFunction& other) noexcept {
+        if (other._vtable) {
+            other._vtable->move(_storage, other._storage);
+            _vtable       = other._vtable;
+            other._vtable = nullptr;
+        }
+    }
+
+    void reset() noexcept {
+        if (_vtable) {
+            _vtable->destroy(_storage);
+            _vtable = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char _storage[InlineSize];  ///< Inline callable or heap pointer.
+    const VTable* _vtable = nullptr;                                ///< Operations of the stored callable.
+};
+
+}  // namespace mrh
@@ -0,0 +1,68 @@
+#include "MRHelper/Cancellation.hpp"
+
+#include <utility>
+
+namespace mrh {
+
+namespace {
+
+const CancellationToken noCancellation;                     ///< Current token of threads outside any scope.
+thread_local const CancellationToken* tlsCurrent = nullptr;  ///< Token of the innermost scope.
+
+}  // namespace
+
+CancellationToken CancellationToken::create() {
+    return CancellationToken(std::make_shared<State>());
+}
+
+CancellationToken CancellationToken::withDeadline(Clock::time_point deadline) {
+    auto state      = std::make_shared<State>();
+    state->deadline = deadline;
+    return CancellationToken(std::move(state));
+}
+
+CancellationToken CancellationToken::withTimeout(Clock::duration timeout) {
+    return withDeadline(Clock::now() + timeout);
+}
+
+CancellationToken CancellationToken::child() const {
+    auto state = std::make_shared<State>();
+    if (_state) {
+        state->deadline = _state->deadline;
+        state->parent   = _state;
+    }
+    return CancellationToken(std::move(state));
+}
+
+void CancellationToken::cancel() const {
+    if (_state)
+        _state->cancelled.store(true, std::memory_order_release);
+}
+
+bool CancellationToken::isCancelled() const {
+    if (!_state)
+        return false;
+    for (const State* state = _state.get(); state; state = state->parent.get()) {
+        if (state->cancelled.load(std::memory_order_acquire))
+            return true;
+    }
+    return _state->deadline != Clock::time_point::max() && Clock::now() >= _state->deadline;
+}
+
+CancellationToken::Clock::time_point CancellationToken::getDeadline() const {
+    return _state ? _state->deadline : Clock::time_point::max();
+}
+
+const CancellationToken& CancellationToken::current() {
+    return tlsCurrent ? *tlsCurrent : noCancellation;
+}
+
+CancellationScope::CancellationScope(const CancellationToken& token) : _previous(tlsCurrent) {
+    tlsCurrent = &token;
+}
+
+CancellationScope::~CancellationScope() {
+    tlsCurrent = _previous;
+}
+
+}  // namespace mrh
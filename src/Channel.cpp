@@ -0,0 +1,152 @@
+#include "MRHelper/Channel.hpp"
+
+#include <stdexcept>
+#include <system_error>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace mrh {
+
+namespace {
+
+constexpr size_t HeaderSize = 17;  ///< Type, id and payload size.
+
+void encodeU64(char* out, uint64_t value) {
+    for (int i = 0; i < 8; ++i)
+        out[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+uint64_t decodeU64(const char* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i)
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    return value;
+}
+
+#ifndef _WIN32
+
+[[noreturn]] void throwSocketError(const char* what) {
+    throw std::system_error(errno, std::system_category(), std::string("SocketChannel: ") + what);
+}
+
+/// Writes all bytes, retrying after interruptions and partial writes.
+void writeAll(int socket, const char* data, size_t size) {
+#ifdef MSG_NOSIGNAL
+    constexpr int flags = MSG_NOSIGNAL;  // A dead peer must not raise SIGPIPE in the coordinator.
+#else
+    constexpr int flags = 0;
+#endif
+    while (size > 0) {
+        const ssize_t n = ::send(socket, data, size, flags);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throwSocketError("send failed");
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+}
+
+/// Reads exactly size bytes; returns false at the end of the stream or if the connection was reset.
+bool readAll(int socket, char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t n = ::recv(socket, data, size, 0);
+        if (n == 0)
+            return false;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == ECONNRESET)
+                return false;
+            throwSocketError("receive failed");
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+#endif
+
+}  // namespace
+
+SocketChannel::SocketChannel(int socket) : _socket(socket) {
+#if !defined(_WIN32) && !defined(MSG_NOSIGNAL) && defined(SO_NOSIGPIPE)
+    const int on = 1;
+    setsockopt(_socket, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+}
+
+SocketChannel::~SocketChannel() {
+    close();
+}
+
+SocketChannel& SocketChannel::operator=(SocketChannel&& other) noexcept {
+    if (this != &other) {
+        close();
+        _socket = std::exchange(other._socket, -1);
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+std::pair<SocketChannel, SocketChannel> SocketChannel::createPair() {
+    throw std::logic_error("SocketChannel: not supported on this platform");
+}
+
+void SocketChannel::send(const Frame&) {
+    throw std::logic_error("SocketChannel: not supported on this platform");
+}
+
+bool SocketChannel::receive(Frame&) {
+    throw std::logic_error("SocketChannel: not supported on this platform");
+}
+
+void SocketChannel::close() {
+    _socket = -1;
+}
+
+#else
+
+std::pair<SocketChannel, SocketChannel> SocketChannel::createPair() {
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+        throwSocketError("cannot create socket pair");
+    return {SocketChannel(sockets[0]), SocketChannel(sockets[1])};
+}
+
+void SocketChannel::send(const Frame& frame) {
+    char header[HeaderSize];
+    header[0] = static_cast<char>(frame.type);
+    encodeU64(header + 1, frame.id);
+    encodeU64(header + 9, frame.payload.size());
+    writeAll(_socket, header, HeaderSize);
+    writeAll(_socket, frame.payload.data(), frame.payload.size());
+}
+
+bool SocketChannel::receive(Frame& frame) {
+    char header[HeaderSize];
+    if (!readAll(_socket, header, HeaderSize))
+        return false;
+    frame.type = static_cast<Frame::Type>(static_cast<unsigned char>(header[0]));
+    frame.id   = decodeU64(header + 1);
+    frame.payload.resize(static_cast<size_t>(decodeU64(header + 9)));
+    return readAll(_socket, frame.payload.data(), frame.payload.size());
+}
+
+void SocketChannel::close() {
+    if (_socket >= 0)
+        ::close(_socket);
+    _socket = -1;
+}
+
+#endif
+
+}  // namespace mrh
@@ -0,0 +1,89 @@
+#include "MRHelper/ExecutionPlan.hpp"
+
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace mrh {
+
+ExecutionPlan::ExecutionPlan(const std::shared_ptr<Task>& root) {
+    if (!root)
+        throw std::invalid_argument("ExecutionPlan: null root task");
+
+    // Iterative post-order DFS. A task is "open" while its dependencies are being
+    // visited; reaching an open task again means a cycle.
+    enum class State { Open, Done };
+    std::unordered_map<Task*, State> state;
+    std::unordered_map<Task*, uint32_t> index;
+    std::vector<std::pair<Task*, size_t>> stack;
+
+    state[root.get()] = State::Open;
+    stack.emplace_back(root.get(), 0);
+    while (!stack.empty()) {
+        auto& [task, next] = stack.back();
+        const auto& deps   = task->getDependencies();
+        if (next < deps.size()) {
+            Task* dep = deps[next++].get();
+            auto it   = state.find(dep);
+            if (it == state.end()) {
+                state.emplace(dep, State::Open);
+                stack.emplace_back(dep, 0);
+            } else if (it->second == State::Open) {
+                throw std::logic_error("ExecutionPlan: dependency cycle in task graph");
+            }
+            continue;
+        }
+        state[task] = State::Done;
+        index[task] = static_cast<uint32_t>(_tasks.size());
+        _tasks.push_back(task->shared_from_this());
+        stack.pop_back();
+    }
+
+    const size_t n = _tasks.size();
+    _indegree.resize(n);
+    _dependentOffsets.assign(n + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        const auto& deps = _tasks[i]->getDependencies();
+        _indegree[i]     = static_cast<int>(deps.size());
+        if (deps.empty())
+            _sources.push_back(static_cast<uint32_t>(i));
+        for (const auto& dep : deps)
+            ++_dependentOffsets[index[dep.get()] + 1];
+    }
+    for (size_t i = 0; i < n; ++i)
+        _dependentOffsets[i + 1] += _dependentOffsets[i];
+
+    _dependents.resize(_dependentOffsets[n]);
+    std::vector<uint32_t> fill(_dependentOffsets.begin(), _dependentOffsets.end() - 1);
+    for (size_t i = 0; i < n; ++i) {
+        for (const auto& dep : _tasks[i]->getDependencies())
+            _dependents[fill[index[dep.get()]]++] = static_cast<uint32_t>(i);
+    }
+}
+
+size_t ExecutionPlan::size() const {
+    return _tasks.size();
+}
+
+uint32_t ExecutionPlan::getRootIndex() const {
+    return static_cast<uint32_t>(_tasks.size() - 1);
+}
+
+const std::shared_ptr<Task>& ExecutionPlan::getTask(uint32_t index) const {
+    return _tasks[index];
+}
+
+int ExecutionPlan::getIndegree(uint32_t index) const {
+    return _indegree[index];
+}
+
+Range<const uint32_t*> ExecutionPlan::getDependents(uint32_t index) const {
+    const uint32_t* data = _dependents.data();
+    return Range<const uint32_t*>(data + _dependentOffsets[index], data + _dependentOffsets[index + 1]);
+}
+
+const std::vector<uint32_t>& ExecutionPlan::getSources() const {
+    return _sources;
+}
+
+}  // namespace mrh
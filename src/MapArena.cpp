@@ -0,0 +1,18 @@
+#include "MRHelper/MapArena.hpp"
+
+#include <cstring>
+
+namespace mrh {
+
+MapArena::MapArena(size_t initialBlockSize) : _resource(initialBlockSize), _interned(&_resource) {}
+
+std::string_view MapArena::intern(std::string_view str) {
+    auto it = _interned.find(str);
+    if (it != _interned.end())
+        return *it;
+    char* copy = static_cast<char*>(_resource.allocate(str.size() ? str.size() : 1, 1));
+    std::memcpy(copy, str.data(), str.size());
+    return *_interned.insert(std::string_view(copy, str.size())).first;
+}
+
+}  // namespace mrh
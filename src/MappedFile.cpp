@@ -0,0 +1,119 @@
+#include "MRHelper/MappedFile.hpp"
+
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace mrh {
+
+namespace {
+
+[[noreturn]] void throwMapError(int error, const std::filesystem::path& path) {
+    throw std::system_error(error, std::system_category(), "MappedFile: cannot map " + path.string());
+}
+
+}  // namespace
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::filesystem::path& path) : _path(path) {
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throwMapError(static_cast<int>(GetLastError()), path);
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        const DWORD error = GetLastError();
+        CloseHandle(file);
+        throwMapError(static_cast<int>(error), path);
+    }
+    _size = static_cast<size_t>(size.QuadPart);
+    if (_size > 0) {
+        // The view keeps the mapping alive after both handles are closed.
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        const DWORD error = GetLastError();
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        if (!view)
+            throwMapError(static_cast<int>(error), path);
+        _data = static_cast<const char*>(view);
+    } else {
+        CloseHandle(file);
+    }
+}
+
+void MappedFile::unmap() noexcept {
+    if (_data)
+        UnmapViewOfFile(_data);
+    _data = nullptr;
+    _size = 0;
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path& path) : _path(path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throwMapError(errno, path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        const int error = errno;
+        ::close(fd);
+        throwMapError(error, path);
+    }
+    _size = static_cast<size_t>(st.st_size);
+    if (_size > 0) {
+        // The mapping stays valid after the descriptor is closed.
+        void* addr      = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+        const int error = errno;
+        ::close(fd);
+        if (addr == MAP_FAILED)
+            throwMapError(error, path);
+        ::madvise(addr, _size, MADV_SEQUENTIAL);
+        _data = static_cast<const char*>(addr);
+    } else {
+        ::close(fd);
+    }
+}
+
+void MappedFile::unmap() noexcept {
+    if (_data)
+        ::munmap(const_cast<char*>(_data), _size);
+    _data = nullptr;
+    _size = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+    unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : _path(std::move(other._path)), _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        _path = std::move(other._path);
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+    }
+    return *this;
+}
+
+}  // namespace mrh
@@ -0,0 +1,16 @@
+#include "MRHelper/MappedFileSource.hpp"
+
+namespace mrh {
+
+MappedFileSource::MappedFileSource(std::vector<std::filesystem::path> paths, char delimiter, bool cacheResult)
+    : TypedTask<MappedFiles>({}, cacheResult), _paths(std::move(paths)), _delimiter(delimiter) {}
+
+Result<MappedFiles> MappedFileSource::runTyped(ThreadPool&) {
+    std::vector<std::shared_ptr<const MappedFile>> files;
+    files.reserve(_paths.size());
+    for (const auto& path : _paths)
+        files.push_back(std::make_shared<const MappedFile>(path));
+    return Result<MappedFiles>(std::make_shared<const MappedFiles>(std::move(files), _delimiter));
+}
+
+}  // namespace mrh
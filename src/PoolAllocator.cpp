@@ -0,0 +1,81 @@
+#include "MRHelper/PoolAllocator.hpp"
+
+namespace mrh {
+
+namespace detail {
+
+namespace {
+
+constexpr size_t BlockGranularity = 64;   ///< Size classes are multiples of this.
+constexpr size_t NumSizeClasses   = 8;    ///< Largest pooled block is 512 bytes.
+constexpr size_t MaxCachedBlocks  = 256;  ///< Per size class and thread.
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+/// Per-thread free lists, one per size class.
+struct BlockCache {
+    FreeBlock* heads[NumSizeClasses] = {};
+    size_t counts[NumSizeClasses]    = {};
+
+    ~BlockCache();
+};
+
+thread_local bool tlsCacheDestroyed = false;  ///< Set once tlsCache has been destroyed at thread exit.
+thread_local BlockCache tlsCache;
+
+BlockCache::~BlockCache() {
+    tlsCacheDestroyed = true;
+    for (FreeBlock*& head : heads) {
+        while (head) {
+            FreeBlock* next = head->next;
+            ::operator delete(head);
+            head = next;
+        }
+    }
+}
+
+/// Returns the calling thread's cache, or nullptr while the thread is exiting.
+BlockCache* cache() {
+    return tlsCacheDestroyed ? nullptr : &tlsCache;
+}
+
+size_t sizeClass(size_t bytes) {
+    return bytes == 0 ? 0 : (bytes - 1) / BlockGranularity;
+}
+
+}  // namespace
+
+void* poolAllocate(size_t bytes) {
+    const size_t cls = sizeClass(bytes);
+    if (cls >= NumSizeClasses)
+        return ::operator new(bytes);
+    if (BlockCache* c = cache()) {
+        if (FreeBlock* block = c->heads[cls]) {
+            c->heads[cls] = block->next;
+            --c->counts[cls];
+            return block;
+        }
+    }
+    return ::operator new((cls + 1) * BlockGranularity);
+}
+
+void poolDeallocate(void* block, size_t bytes) noexcept {
+    const size_t cls = sizeClass(bytes);
+    if (cls < NumSizeClasses) {
+        BlockCache* c = cache();
+        if (c && c->counts[cls] < MaxCachedBlocks) {
+            auto* free    = static_cast<FreeBlock*>(block);
+            free->next    = c->heads[cls];
+            c->heads[cls] = free;
+            ++c->counts[cls];
+            return;
+        }
+    }
+    ::operator delete(block);
+}
+
+}  // namespace detail
+
+}  // namespace mrh
@@ -0,0 +1,224 @@
+#include "MRHelper/ProcessExecutor.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include "MRHelper/ThreadPool.hpp"
+
+namespace mrh {
+
+ProcessExecutor::ProcessExecutor(size_t numProcesses, size_t maxAttempts)
+    : _numProcesses(std::max<size_t>(1, numProcesses)), _maxAttempts(std::max<size_t>(1, maxAttempts)) {}
+
+void ProcessExecutor::serve(Channel& channel, const Handler& handler) {
+    Frame frame;
+    while (channel.receive(frame)) {
+        Frame reply{Frame::Type::Reply, frame.id, {}};
+        try {
+            reply.payload = handler(frame.payload);
+        } catch (const std::exception& e) {
+            reply.type    = Frame::Type::Error;
+            reply.payload = e.what();
+        } catch (...) {
+            reply.type    = Frame::Type::Error;
+            reply.payload = "ProcessExecutor: unknown exception in worker";
+        }
+        channel.send(reply);
+    }
+}
+
+#ifdef _WIN32
+
+bool ProcessExecutor::isSupported() {
+    return false;
+}
+
+std::vector<std::string> ProcessExecutor::run(const std::vector<std::string>&, const Handler&) {
+    throw std::logic_error("ProcessExecutor: worker processes are not supported on this platform");
+}
+
+#else
+
+namespace {
+
+constexpr size_t Idle = static_cast<size_t>(-1);  ///< Request of a worker without work.
+
+/// A worker process and the coordinator's end of its channel.
+struct Worker {
+    pid_t pid = -1;             ///< Process id, -1 if not running.
+    SocketChannel channel{-1};  ///< Channel to the worker.
+    size_t request = Idle;      ///< Request being run, or Idle.
+};
+
+/// The workers of one run; stops them when the run ends, however it ends.
+class Workers {
+public:
+    Workers(size_t count, const ProcessExecutor::Handler& handler) : _workers(count), _handler(handler) {}
+
+    ~Workers() {
+        for (Worker& worker : _workers) {
+            // A busy worker is only left behind when the run failed; it has nothing left to deliver.
+            if (worker.pid > 0 && worker.request != Idle)
+                kill(worker.pid, SIGKILL);
+            worker.channel.close();
+        }
+        for (Worker& worker : _workers)
+            reap(worker);
+    }
+
+    Workers(const Workers&)            = delete;
+    Workers& operator=(const Workers&) = delete;
+
+    std::vector<Worker>& get() { return _workers; }
+
+    /// Forks a worker process into a slot.
+    void spawn(Worker& worker) {
+        auto channels   = SocketChannel::createPair();
+        const pid_t pid = fork();
+        if (pid < 0)
+            throw std::system_error(errno, std::system_category(), "ProcessExecutor: cannot fork worker");
+        if (pid == 0) {
+            // Drop the coordinator's ends inherited from the parent, so that
+            // every worker sees the end of its channel when the coordinator
+            // closes it.
+            channels.first.close();
+            for (Worker& other : _workers)
+                other.channel.close();
+            try {
+                ProcessExecutor::serve(channels.second, _handler);
+            } catch (...) {
+            }
+            _exit(0);
+        }
+        worker.pid     = pid;
+        worker.channel = std::move(channels.first);
+        worker.request = Idle;
+    }
+
+    /// Waits for a worker process that has exited or been told to.
+    static void reap(Worker& worker) {
+        if (worker.pid <= 0)
+            return;
+        while (waitpid(worker.pid, nullptr, 0) < 0 && errno == EINTR) {
+        }
+        worker.pid = -1;
+    }
+
+private:
+    std::vector<Worker> _workers;              ///< Worker slots.
+    const ProcessExecutor::Handler& _handler;  ///< Handler of the run.
+};
+
+}  // namespace
+
+bool ProcessExecutor::isSupported() {
+    return true;
+}
+
+std::vector<std::string> ProcessExecutor::run(const std::vector<std::string>& requests, const Handler& handler) {
+    std::vector<std::string> replies(requests.size());
+    if (requests.empty())
+        return replies;
+
+    std::vector<size_t> attempts(requests.size(), 0);
+    std::deque<size_t> queue;
+    for (size_t r = 0; r < requests.size(); ++r)
+        queue.push_back(r);
+    size_t remaining = requests.size();
+
+    Workers workers(std::min(_numProcesses, requests.size()), handler);
+    for (Worker& worker : workers.get())
+        workers.spawn(worker);
+
+    // Replaces a worker that died; its request goes back to the front of the queue.
+    auto replace = [&](Worker& worker) {
+        worker.channel.close();
+        Workers::reap(worker);
+        if (worker.request != Idle) {
+            if (attempts[worker.request] >= _maxAttempts) {
+                throw std::runtime_error("ProcessExecutor: request " + std::to_string(worker.request) + " killed " +
+                                         std::to_string(attempts[worker.request]) + " worker processes");
+            }
+            queue.push_front(worker.request);
+        }
+        ++_numRestarts;
+        workers.spawn(worker);
+    };
+
+    std::vector<pollfd> polled;
+    std::vector<Worker*> busy;
+    while (remaining > 0) {
+        for (Worker& worker : workers.get()) {
+            if (worker.request != Idle || queue.empty())
+                continue;
+            const size_t request = queue.front();
+            queue.pop_front();
+            try {
+                worker.channel.send(Frame{Frame::Type::Request, request, requests[request]});
+            } catch (const std::system_error&) {
+                // The worker died while idle; the request has not been tried.
+                queue.push_front(request);
+                replace(worker);
+                continue;
+            }
+            worker.request = request;
+            ++attempts[request];
+        }
+
+        polled.clear();
+        busy.clear();
+        for (Worker& worker : workers.get()) {
+            if (worker.request != Idle) {
+                polled.push_back(pollfd{worker.channel.getSocket(), POLLIN, 0});
+                busy.push_back(&worker);
+            }
+        }
+        if (busy.empty())
+            continue;
+        int ready;
+        {
+            const auto region = ThreadPool::blockingRegion();
+            ready = poll(polled.data(), static_cast<nfds_t>(polled.size()), -1);
+        }
+        if (ready < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::system_category(), "ProcessExecutor: poll failed");
+        }
+        for (size_t i = 0; i < busy.size(); ++i) {
+            if (polled[i].revents == 0)
+                continue;
+            Worker& worker = *busy[i];
+            Frame frame;
+            if (!worker.channel.receive(frame)) {
+                replace(worker);
+                continue;
+            }
+            if (frame.type == Frame::Type::Error)
+                throw std::runtime_error(frame.payload);
+            if (frame.type != Frame::Type::Reply || frame.id != worker.request)
+                throw std::runtime_error("ProcessExecutor: unexpected frame from worker");
+            replies[worker.request] = std::move(frame.payload);
+            worker.request          = Idle;
+            --remaining;
+        }
+    }
+    return replies;
+}
+
+#endif
+
+}  // namespace mrh
@@ -0,0 +1,142 @@
+#include "MRHelper/ResultStore.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace mrh {
+
+namespace {
+
+constexpr const char* EntryExtension = ".result";  ///< Extension of entry files.
+
+/// Returns a suffix for a temporary entry file that no other writer, in this or another process, uses.
+std::string tempSuffix() {
+    static std::atomic<uint64_t> counter{0};
+    static const uint64_t salt = (static_cast<uint64_t>(std::random_device()()) << 32) ^ std::random_device()();
+    return "." + std::to_string(salt) + "-" + std::to_string(counter++) + ".tmp";
+}
+
+}  // namespace
+
+ResultStore::ResultStore(std::filesystem::path directory, uint64_t maxBytes)
+    : _directory(std::move(directory)), _maxBytes(maxBytes) {
+    std::filesystem::create_directories(_directory);
+    struct Found {
+        std::filesystem::file_time_type lastWrite;
+        uint64_t fingerprint;
+        uint64_t size;
+    };
+    std::vector<Found> found;
+    for (const auto& file : std::filesystem::directory_iterator(_directory)) {
+        if (!file.is_regular_file() || file.path().extension() != EntryExtension)
+            continue;
+        const std::string name = file.path().stem().string();
+        char* end              = nullptr;
+        const uint64_t fingerprint = std::strtoull(name.c_str(), &end, 16);
+        if (name.size() != 16 || *end != '\0')
+            continue;
+        std::error_code ec;
+        const uint64_t size  = file.file_size(ec);
+        const auto lastWrite = file.last_write_time(ec);
+        if (ec)
+            continue;
+        found.push_back(Found{lastWrite, fingerprint, size});
+    }
+    // Modification times only seed the order; equal times are broken by fingerprint so every open agrees.
+    std::sort(found.begin(), found.end(), [](const Found& lhs, const Found& rhs) {
+        return std::tie(lhs.lastWrite, lhs.fingerprint) < std::tie(rhs.lastWrite, rhs.fingerprint);
+    });
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const Found& file : found) {
+        _entries[file.fingerprint] = Entry{file.size, ++_clock};
+        _size += file.size;
+    }
+    evict();
+}
+
+bool ResultStore::load(uint64_t fingerprint, std::string& bytes) {
+    const std::filesystem::path path = pathOf(fingerprint);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _entries.find(fingerprint);
+        if (it == _entries.end())
+            return false;
+        it->second.lastUse = ++_clock;
+        std::error_code ec;
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+    }
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+void ResultStore::store(uint64_t fingerprint, const std::string& bytes) {
+    if (bytes.size() > _maxBytes)
+        return;
+    const std::filesystem::path path = pathOf(fingerprint);
+    std::filesystem::path temp       = path;
+    temp += tempSuffix();
+    {
+        // Written under a temporary name and renamed, so readers never see a partial entry.
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        if (!out)
+            return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::error_code ec;
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+        std::filesystem::remove(temp, ec);
+        return;
+    }
+    Entry& entry = _entries[fingerprint];
+    _size        = _size - entry.size + bytes.size();
+    entry        = Entry{bytes.size(), ++_clock};
+    evict();
+}
+
+uint64_t ResultStore::getSize() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _size;
+}
+
+size_t ResultStore::getNumEntries() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.size();
+}
+
+std::filesystem::path ResultStore::pathOf(uint64_t fingerprint) const {
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(fingerprint));
+    return _directory / (std::string(name) + EntryExtension);
+}
+
+void ResultStore::evict() {
+    while (_size > _maxBytes && !_entries.empty()) {
+        auto oldest = _entries.begin();
+        for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+            if (it->second.lastUse < oldest->second.lastUse)
+                oldest = it;
+        }
+        std::error_code ec;
+        std::filesystem::remove(pathOf(oldest->first), ec);
+        _size -= oldest->second.size;
+        _entries.erase(oldest);
+    }
+}
+
+}  // namespace mrh
@@ -1,87 +1,225 @@
 #include "MRHelper/Scheduler.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <future>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
-#include <thread>
+#include <utility>
 #include <vector>
 
+#include "MRHelper/TaskGroup.hpp"
+#include "MRHelper/Trace.hpp"
+
 namespace mrh {
 
 Scheduler::Scheduler(size_t numThreads) : _threadPool(numThreads) {}
 
+Scheduler::Scheduler(const ThreadPool::Elasticity& elasticity) : _threadPool(elasticity) {}
+
 Scheduler::~Scheduler() {}
 
-void Scheduler::buildGraph(const std::shared_ptr<Task>& task, std::unordered_map<Task*, int>& indegree,
-                           std::unordered_map<Task*, std::vector<std::shared_ptr<Task>>>& graph,
-                           std::unordered_map<Task*, std::shared_ptr<Task>>& taskMap,
-                           std::unordered_map<Task*, bool>& visited) {
-    if (!task || visited[task.get()])
-        return;
-    visited[task.get()]  = true;
-    taskMap[task.get()]  = task;
-    indegree[task.get()] = static_cast<int>(task->getDependencies().size());
-    for (auto& dep : task->getDependencies()) {
-        graph[dep.get()].push_back(task);
-        buildGraph(dep, indegree, graph, taskMap, visited);
+struct Scheduler::Run {
+    /// Dispatch rank of a task under Policy::CriticalPath; larger ranks run first.
+    using Rank = std::pair<int, uint64_t>;
+
+    /**
+     * @brief Prepares a run of a plan with every task waiting for all of its dependencies.
+     *
+     * @param plan The plan to execute.
+     * @param threadPool Pool the tasks are dispatched to.
+     * @param token Token the run is cancelled with.
+     * @param cancelOnFailure Whether the first failing task cancels the rest of the run.
+     */
+    Run(const ExecutionPlan& plan, ThreadPool& threadPool, const CancellationToken& token, bool cancelOnFailure)
+        : plan(plan), remaining(new std::atomic<int>[plan.size()]), group(threadPool, token, cancelOnFailure) {
+        for (uint32_t i = 0; i < plan.size(); ++i)
+            remaining[i].store(plan.getIndegree(i), std::memory_order_relaxed);
     }
+
+    const ExecutionPlan& plan;                      ///< The plan being executed.
+    std::unique_ptr<std::atomic<int>[]> remaining;  ///< Unfinished dependencies per task.
+    TaskGroup group;                                ///< Joins all dispatched tasks.
+    std::any rootResult;                            ///< Result of the root task.
+    std::vector<Rank> ranks;                        ///< Effective priority and remaining path per task.
+    std::vector<uint32_t> ready;                    ///< Max-heap by rank of tasks waiting for a pool job.
+    std::mutex readyMutex;                          ///< Protects ready.
+};
+
+std::any Scheduler::execute(const std::shared_ptr<Task>& root, const CancellationToken& token) {
+    return execute(*compile(root), token);
 }
 
-std::any Scheduler::execute(const std::shared_ptr<Task>& root) {
-    std::unordered_map<Task*, int> indegree;
-    std::unordered_map<Task*, std::vector<std::shared_ptr<Task>>> graph;
-    std::unordered_map<Task*, std::shared_ptr<Task>> taskMap;
-    std::unordered_map<Task*, bool> visited;
-    buildGraph(root, indegree, graph, taskMap, visited);
+std::any Scheduler::execute(const ExecutionPlan& plan, const CancellationToken& token) {
+    MRH_TRACE_SCOPE("Scheduler::execute", "scheduler");
+    Run run(plan, _threadPool, token, _cancelOnFailure);
+    if (_policy == Policy::Fifo) {
+        for (uint32_t source : plan.getSources())
+            dispatch(run, source);
+    } else {
+        rankTasks(run);
+        // Best first, so that a job starting while the sources are queued already takes the best one.
+        std::vector<uint32_t> sources = plan.getSources();
+        std::sort(sources.begin(), sources.end(),
+                  [&run](uint32_t lhs, uint32_t rhs) { return run.ranks[rhs] < run.ranks[lhs]; });
+        for (uint32_t source : sources)
+            dispatch(run, source);
+    }
+    run.group.wait();
+    _executions.fetch_add(1, std::memory_order_relaxed);
+    return std::move(run.rootResult);
+}
 
-    std::unordered_map<Task*, std::atomic<int>> remainingDeps;
-    for (auto& pair : indegree) {
-        remainingDeps[pair.first] = pair.second;
+void Scheduler::dispatch(Run& run, uint32_t index) {
+    if (!run.plan.getTask(index)->isDirty()) {
+        // Clean tasks only hand out their cached result: complete them, and any
+        // clean tasks they unblock, inline instead of going through the pool.
+        std::vector<uint32_t> clean{index};
+        while (!clean.empty()) {
+            const uint32_t i = clean.back();
+            clean.pop_back();
+            _tasksSkipped.fetch_add(1, std::memory_order_relaxed);
+            if (i == run.plan.getRootIndex())
+                run.rootResult = run.plan.getTask(i)->execute(_threadPool);
+            for (uint32_t dependent : run.plan.getDependents(i)) {
+                if (run.remaining[dependent].fetch_sub(1, std::memory_order_acq_rel) != 1)
+                    continue;
+                if (run.plan.getTask(dependent)->isDirty())
+                    dispatch(run, dependent);
+                else
+                    clean.push_back(dependent);
+            }
+        }
+        return;
+    }
+    if (_policy == Policy::Fifo) {
+        run.group.run([this, &run, index]() { runTask(run, index); });
+        return;
     }
+    auto byRank = [&run](uint32_t lhs, uint32_t rhs) { return run.ranks[lhs] < run.ranks[rhs]; };
+    {
+        std::lock_guard<std::mutex> lock(run.readyMutex);
+        run.ready.push_back(index);
+        std::push_heap(run.ready.begin(), run.ready.end(), byRank);
+    }
+    // Every queued task gets one pool job, but a job runs the best task queued when it starts.
+    run.group.run([this, &run, byRank]() {
+        uint32_t next;
+        {
+            std::lock_guard<std::mutex> lock(run.readyMutex);
+            std::pop_heap(run.ready.begin(), run.ready.end(), byRank);
+            next = run.ready.back();
+            run.ready.pop_back();
+        }
+        runTask(run, next);
+    });
+}
 
-    std::mutex queueMutex;
-    std::queue<std::shared_ptr<Task>> readyQueue;
-    for (auto& pair : taskMap) {
-        Task* t = pair.first;
-        if (remainingDeps[t] == 0) {
-            readyQueue.push(pair.second);
+void Scheduler::runTask(Run& run, uint32_t index) {
+    const auto& task = run.plan.getTask(index);
+    const auto start = std::chrono::steady_clock::now();
+    // The task may complete on another thread, e.g. when a coroutine task resumes; the run waits for it.
+    run.group.hold();
+    auto done = [this, &run, index, start](std::exception_ptr error) {
+        if (!error) {
+            const auto end      = std::chrono::steady_clock::now();
+            const uint64_t took = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            run.plan.getTask(index)->_lastRuntime.store(took, std::memory_order_relaxed);
+            _taskTime.fetch_add(took, std::memory_order_relaxed);
+            _tasksRun.fetch_add(1, std::memory_order_relaxed);
+            for (uint32_t dependent : run.plan.getDependents(index)) {
+                if (run.remaining[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    dispatch(run, dependent);
+            }
         }
+        run.group.release(std::move(error));
+    };
+    // Only the root result is handed out; other results stay shared inside their tasks.
+    if (index == run.plan.getRootIndex()) {
+        task->executeAsync(_threadPool, [&run, done](std::any result, std::exception_ptr error) {
+            if (!error)
+                run.rootResult = std::move(result);
+            done(std::move(error));
+        });
+    } else {
+        task->executeRawAsync(_threadPool, [done](std::any, std::exception_ptr error) { done(std::move(error)); });
     }
+}
 
-    std::atomic<int> tasksRemaining(static_cast<int>(taskMap.size()));
+void Scheduler::rankTasks(Run& run) {
+    const ExecutionPlan& plan = run.plan;
+    const uint32_t n          = static_cast<uint32_t>(plan.size());
 
-    while (tasksRemaining > 0) {
-        std::shared_ptr<Task> task;
-        {
-            std::lock_guard<std::mutex> lock(queueMutex);
-            if (!readyQueue.empty()) {
-                task = readyQueue.front();
-                readyQueue.pop();
-            }
+    // Tasks that have not run yet are assumed to take the mean of the known runtimes.
+    uint64_t known = 0, total = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        if (const uint64_t runtime = plan.getTask(i)->getLastRuntime()) {
+            ++known;
+            total += runtime;
         }
-        if (task) {
-            task->execute(_threadPool);
-            {
-                std::lock_guard<std::mutex> lock(queueMutex);
-                for (auto& dependent : graph[task.get()]) {
-                    int newVal = --remainingDeps[dependent.get()];
-                    if (newVal == 0) {
-                        readyQueue.push(dependent);
-                    }
-                }
-            }
-            --tasksRemaining;
-        } else {
-            if (!_threadPool.tryExecuteOne()) {
-                std::this_thread::yield();
-            }
+    }
+    const uint64_t fallback = known ? std::max<uint64_t>(1, total / known) : 1;
+
+    // Dependents come later in topological order, so one backward pass sees them first.
+    run.ranks.resize(n);
+    for (uint32_t i = n; i-- > 0;) {
+        const Task& task    = *plan.getTask(i);
+        const uint64_t cost = task.getLastRuntime() ? task.getLastRuntime() : fallback;
+        Run::Rank rank(task.getPriority(), 0);
+        for (uint32_t dependent : plan.getDependents(i)) {
+            rank.first  = std::max(rank.first, run.ranks[dependent].first);
+            rank.second = std::max(rank.second, run.ranks[dependent].second);
         }
+        rank.second += cost;
+        run.ranks[i] = rank;
     }
+}
+
+std::shared_ptr<const ExecutionPlan> Scheduler::compile(const std::shared_ptr<Task>& root) {
+    return std::make_shared<const ExecutionPlan>(root);
+}
+
+std::future<std::any> Scheduler::submit(const std::shared_ptr<Task>& root, CancellationToken token) {
+    return _threadPool.enqueue([this, root, token = std::move(token)]() { return this->execute(root, token); });
+}
+
+std::future<std::any> Scheduler::submit(std::shared_ptr<const ExecutionPlan> plan, CancellationToken token) {
+    return _threadPool.enqueue(
+        [this, plan = std::move(plan), token = std::move(token)]() { return this->execute(*plan, token); });
+}
+
+void Scheduler::setCancelOnFailure(bool cancelOnFailure) {
+    _cancelOnFailure = cancelOnFailure;
+}
+
+bool Scheduler::getCancelOnFailure() const {
+    return _cancelOnFailure;
+}
+
+void Scheduler::setPolicy(Policy policy) {
+    _policy = policy;
+}
+
+Scheduler::Policy Scheduler::getPolicy() const {
+    return _policy;
+}
 
-    return root->getResult();
+Scheduler::Stats Scheduler::getStats() const {
+    Stats stats;
+    stats.executions   = _executions.load(std::memory_order_relaxed);
+    stats.tasksRun     = _tasksRun.load(std::memory_order_relaxed);
+    stats.tasksSkipped = _tasksSkipped.load(std::memory_order_relaxed);
+    stats.taskTime     = _taskTime.load(std::memory_order_relaxed);
+    return stats;
 }
 
-std::future<std::any> Scheduler::submit(const std::shared_ptr<Task>& root) {
-    return _threadPool.enqueue([this, root]() { return this->execute(root); });
+void Scheduler::resetStats() {
+    _executions   = 0;
+    _tasksRun     = 0;
+    _tasksSkipped = 0;
+    _taskTime     = 0;
 }
 
 }  // namespace mrh
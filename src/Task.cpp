@@ -1,30 +1,299 @@
 #include "MRHelper/Task.hpp"
 
+#include <exception>
 #include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "MRHelper/Cancellation.hpp"
+#include "MRHelper/ResultStore.hpp"
 #include "MRHelper/ThreadPool.hpp"
+#include "MRHelper/Trace.hpp"
 
 namespace mrh {
 
 Task::Task(bool cacheResult) : _cacheResult(cacheResult) {}
 
 std::any Task::execute(ThreadPool& threadPool) {
-    if (_cacheResult) {
-        std::call_once(_onceFlag, [&]() {
-            std::any res = runImpl(threadPool);
-            {
-                std::lock_guard<std::mutex> lock(_mutex);
-                _result = res;
-            }
-            _condVar.notify_all();
-        });
-        std::unique_lock<std::mutex> lock(_mutex);
+    return exportResult(executeRaw(threadPool));
+}
+
+std::any Task::executeRaw(ThreadPool& threadPool) {
+    if (!_cacheResult) {
+        CancellationToken::current().throwIfCancelled();
+        MRH_TRACE_SCOPE("Task::run", "task");
+        return runImpl(threadPool);
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    // Another thread computing the result is waited for, as with a single execution.
+    if (_state == State::Running) {
+        const auto region = ThreadPool::blockingRegion();
+        _condVar.wait(lock, [this] { return _state != State::Running; });
+    }
+    if (_state == State::Clean)
         return _result;
-    } else {
+    CancellationToken::current().throwIfCancelled();
+
+    _state                 = State::Running;
+    const uint64_t version = _version;
+    const bool lookup      = !_bypassStore;
+    _bypassStore           = false;
+    lock.unlock();
+    std::any res;
+    try {
+        res = runOrLoad(threadPool, lookup);
+    } catch (...) {
+        finishRun(version, {}, std::current_exception());
+        throw;
+    }
+    return finishRun(version, std::move(res), nullptr);
+}
+
+void Task::executeAsync(ThreadPool& threadPool, Completion done) {
+    executeRawAsync(threadPool, [this, done = std::move(done)](std::any raw, std::exception_ptr error) {
+        if (error)
+            done({}, std::move(error));
+        else
+            done(exportResult(std::move(raw)), nullptr);
+    });
+}
+
+void Task::executeRawAsync(ThreadPool& threadPool, Completion done) {
+    if (!_cacheResult) {
+        if (CancellationToken::current().isCancelled())
+            done({}, std::make_exception_ptr(OperationCancelled()));
+        else
+            runAsyncImpl(threadPool, std::move(done));
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_state == State::Clean) {
+        std::any result = _result;
+        lock.unlock();
+        done(std::move(result), nullptr);
+        return;
+    }
+    if (_state == State::Running) {
+        _waiters.push_back(std::move(done));
+        return;
+    }
+    if (CancellationToken::current().isCancelled()) {
+        lock.unlock();
+        done({}, std::make_exception_ptr(OperationCancelled()));
+        return;
+    }
+
+    _state                 = State::Running;
+    const uint64_t version = _version;
+    const bool lookup      = !_bypassStore;
+    _bypassStore           = false;
+    _waiters.push_back(std::move(done));
+    lock.unlock();
+
+    std::optional<uint64_t> fingerprint;
+    if (_resultStore)
+        fingerprint = getFingerprint();
+    std::any raw;
+    if (fingerprint && lookup && loadStored(*fingerprint, raw)) {
+        finishRun(version, std::move(raw), nullptr);
+        return;
+    }
+    runAsyncImpl(threadPool, [this, version, fingerprint](std::any raw, std::exception_ptr error) {
+        if (!error && fingerprint)
+            storeResult(*fingerprint, raw);
+        finishRun(version, std::move(raw), std::move(error));
+    });
+}
+
+void Task::runAsyncImpl(ThreadPool& threadPool, Completion done) {
+    std::any raw;
+    try {
+        MRH_TRACE_SCOPE("Task::run", "task");
+        raw = runImpl(threadPool);
+    } catch (...) {
+        done({}, std::current_exception());
+        return;
+    }
+    done(std::move(raw), nullptr);
+}
+
+std::any Task::finishRun(uint64_t version, std::any raw, std::exception_ptr error) {
+    std::vector<Completion> waiters;
+    std::any result;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (error) {
+            _state = State::Dirty;
+        } else {
+            _result = std::move(raw);
+            // An invalidation that arrived while running leaves the result stale.
+            _state = _version == version ? State::Clean : State::Dirty;
+            result = _result;
+        }
+        waiters.swap(_waiters);
+    }
+    _condVar.notify_all();
+    for (Completion& waiter : waiters)
+        waiter(result, error);
+    return result;
+}
+
+std::any Task::runOrLoad(ThreadPool& threadPool, bool lookup) {
+    std::optional<uint64_t> fingerprint;
+    if (_resultStore)
+        fingerprint = getFingerprint();
+    MRH_TRACE_SCOPE("Task::run", "task");
+    if (!fingerprint)
         return runImpl(threadPool);
+
+    std::any raw;
+    if (lookup && loadStored(*fingerprint, raw))
+        return raw;
+    raw = runImpl(threadPool);
+    storeResult(*fingerprint, raw);
+    return raw;
+}
+
+bool Task::loadStored(uint64_t fingerprint, std::any& raw) const {
+    std::string bytes;
+    if (!_resultStore->load(fingerprint, bytes))
+        return false;
+    // A corrupt or foreign entry is a cache miss, and the task recomputes and overwrites it.
+    try {
+        std::istringstream in(std::move(bytes));
+        return deserializeResult(in, raw);
+    } catch (const std::exception&) {
+        raw.reset();
+        return false;
     }
 }
 
+void Task::storeResult(uint64_t fingerprint, const std::any& raw) const {
+    std::ostringstream out;
+    if (serializeResult(raw, out))
+        _resultStore->store(fingerprint, out.str());
+}
+
+void Task::invalidate() {
+    // Iterative traversal visiting every task once, so shared dependents of diamonds are not revisited.
+    std::vector<std::shared_ptr<Task>> stack{shared_from_this()};
+    std::unordered_set<const Task*> visited{this};
+    while (!stack.empty()) {
+        std::shared_ptr<Task> task = std::move(stack.back());
+        stack.pop_back();
+        {
+            std::lock_guard<std::mutex> lock(task->_mutex);
+            ++task->_version;
+            task->_bypassStore = true;
+            if (task->_state == State::Clean)
+                task->_state = State::Dirty;
+        }
+        for (const auto& weak : task->_dependents) {
+            auto dependent = weak.lock();
+            if (dependent && visited.insert(dependent.get()).second)
+                stack.push_back(std::move(dependent));
+        }
+    }
+}
+
+bool Task::isDirty() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return !_cacheResult || _state != State::Clean;
+}
+
+void Task::setCacheKey(std::string cacheKey) {
+    _cacheKey = std::move(cacheKey);
+    resetFingerprints();
+}
+
+std::optional<uint64_t> Task::getFingerprint() const {
+    // Iterative post-order DFS, so deep chains do not recurse. Every task's
+    // fingerprint is computed once and cached, so shared dependencies of
+    // diamonds are hashed once and later calls only read the cache.
+    auto cached = [](const Task& task, std::optional<uint64_t>& fingerprint) {
+        std::lock_guard<std::mutex> lock(task._mutex);
+        fingerprint = task._fingerprint;
+        return task._fingerprintKnown;
+    };
+    std::optional<uint64_t> fingerprint;
+    if (cached(*this, fingerprint))
+        return fingerprint;
+
+    std::unordered_map<const Task*, std::optional<uint64_t>> computed;
+    std::vector<std::pair<const Task*, size_t>> stack{{this, 0}};
+    while (!stack.empty()) {
+        auto& [task, next] = stack.back();
+        if (task->_cacheKey && next < task->_dependencies.size()) {
+            const Task* dependency = task->_dependencies[next++].get();
+            if (computed.count(dependency))
+                continue;
+            std::optional<uint64_t> known;
+            if (cached(*dependency, known))
+                computed.emplace(dependency, known);
+            else
+                stack.emplace_back(dependency, 0);
+            continue;
+        }
+        std::optional<uint64_t> result;
+        if (task->_cacheKey) {
+            result = detail::fingerprintOf(*task->_cacheKey);
+            for (const auto& dependency : task->_dependencies) {
+                const std::optional<uint64_t>& dependencyFingerprint = computed.at(dependency.get());
+                if (!dependencyFingerprint) {
+                    result.reset();
+                    break;
+                }
+                result = detail::combineFingerprints(*result, *dependencyFingerprint);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(task->_mutex);
+            task->_fingerprint      = result;
+            task->_fingerprintKnown = true;
+        }
+        computed[task] = result;
+        stack.pop_back();
+    }
+    return computed.at(this);
+}
+
+void Task::resetFingerprints() {
+    // A fingerprint covers all transitive dependencies, so the cached ones of all dependents are stale too.
+    // This task is not taken from shared_from_this(): setCacheKey() may run before a shared_ptr owns it.
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _fingerprintKnown = false;
+    }
+    std::vector<std::shared_ptr<Task>> stack;
+    std::unordered_set<const Task*> visited{this};
+    auto pushDependents = [&stack, &visited](const Task& task) {
+        for (const auto& weak : task._dependents) {
+            auto dependent = weak.lock();
+            if (dependent && visited.insert(dependent.get()).second)
+                stack.push_back(std::move(dependent));
+        }
+    };
+    pushDependents(*this);
+    while (!stack.empty()) {
+        std::shared_ptr<Task> task = std::move(stack.back());
+        stack.pop_back();
+        {
+            std::lock_guard<std::mutex> lock(task->_mutex);
+            task->_fingerprintKnown = false;
+        }
+        pushDependents(*task);
+    }
+}
+
+void Task::setResultStore(std::shared_ptr<ResultStore> resultStore) {
+    _resultStore = std::move(resultStore);
+}
+
 void Task::setCacheResult(bool cacheResult) {
     _cacheResult = cacheResult;
 }
@@ -33,10 +302,23 @@ bool Task::getCacheResult() const {
     return _cacheResult;
 }
 
+void Task::setPriority(int priority) {
+    _priority = priority;
+}
+
+int Task::getPriority() const {
+    return _priority;
+}
+
+uint64_t Task::getLastRuntime() const {
+    return _lastRuntime.load(std::memory_order_relaxed);
+}
+
 void Task::dependsOn(const std::shared_ptr<Task>& dependency) {
     if (dependency) {
         _dependencies.push_back(dependency);
         dependency->addDependent(shared_from_this());
+        resetFingerprints();
     }
 }
 
@@ -53,8 +335,24 @@ const std::vector<std::weak_ptr<Task>>& Task::getDependents() const {
 }
 
 std::any Task::getResult() const {
+    return exportResult(getRawResult());
+}
+
+std::any Task::getRawResult() const {
     std::unique_lock<std::mutex> lock(_mutex);
     return _result;
 }
 
+std::any Task::exportResult(std::any raw) const {
+    return raw;
+}
+
+bool Task::serializeResult(const std::any&, std::ostream&) const {
+    return false;
+}
+
+bool Task::deserializeResult(std::istream&, std::any&) const {
+    return false;
+}
+
 }  // namespace mrh
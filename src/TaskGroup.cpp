@@ -0,0 +1,107 @@
+#include "MRHelper/TaskGroup.hpp"
+
+#include "MRHelper/Trace.hpp"
+
+namespace mrh {
+
+TaskGroup::TaskGroup(ThreadPool& threadPool, const CancellationToken& token, bool cancelOnError)
+    : _threadPool(threadPool), _token(token.child()), _cancelOnError(cancelOnError) {}
+
+TaskGroup::~TaskGroup() {
+    try {
+        wait();
+    } catch (...) {
+    }
+}
+
+void TaskGroup::submit(std::shared_ptr<Child> child, size_t node) {
+    ++_pending;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _unclaimed.push_back(child);
+    }
+    _condition.notify_all();
+    _threadPool.push(
+        [this, child = std::move(child)]() {
+            // The group is alive while the child is pending, and only the claimer may touch it.
+            if (!child->claimed.exchange(true))
+                execute(*child);
+        },
+        node);
+}
+
+void TaskGroup::execute(Child& child) {
+    try {
+        _token.throwIfCancelled();
+        CancellationScope scope(_token);
+        child.func();
+    } catch (...) {
+        fail(std::current_exception());
+    }
+    child.func = nullptr;
+    finish();
+}
+
+void TaskGroup::fail(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_error)
+        _error = std::move(error);
+    if (_cancelOnError)
+        _token.cancel();
+}
+
+void TaskGroup::finish() {
+    // The last decrement happens under the lock, so a waiter that observes zero
+    // cannot destroy the group before this thread is done with it.
+    size_t pending = _pending.load();
+    while (pending > 1) {
+        if (_pending.compare_exchange_weak(pending, pending - 1))
+            return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (--_pending == 0)
+        _condition.notify_all();
+}
+
+void TaskGroup::hold() {
+    ++_pending;
+}
+
+void TaskGroup::release(std::exception_ptr error) {
+    if (error)
+        fail(std::move(error));
+    finish();
+}
+
+void TaskGroup::cancel() {
+    _token.cancel();
+}
+
+void TaskGroup::wait() {
+    for (;;) {
+        std::shared_ptr<Child> child;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            auto ready = [this] { return _pending == 0 || !_unclaimed.empty(); };
+            if (!ready()) {
+                MRH_TRACE_SCOPE("TaskGroup::wait", "wait");
+                const auto region = ThreadPool::blockingRegion();
+                _condition.wait(lock, ready);
+            }
+            if (_unclaimed.empty()) {
+                std::exception_ptr error = std::move(_error);
+                _error                   = nullptr;
+                lock.unlock();
+                if (error)
+                    std::rethrow_exception(error);
+                return;
+            }
+            child = std::move(_unclaimed.back());
+            _unclaimed.pop_back();
+        }
+        if (!child->claimed.exchange(true))
+            execute(*child);
+    }
+}
+
+}  // namespace mrh
@@ -1,26 +1,90 @@
 #include "MRHelper/ThreadPool.hpp"
 
+#include <algorithm>
+#include <stdexcept>
 #include <utility>
 
+#include "MRHelper/Trace.hpp"
+
 namespace mrh {
 
-ThreadPool::ThreadPool(size_t numThreads) : _stop(false) {
-    for (size_t i = 0; i < numThreads; ++i) {
-        _workers.emplace_back([this] {
-            for (;;) {
-                std::function<void()> task;
-                {
-                    std::unique_lock<std::mutex> lock(this->_queueMutex);
-                    this->_condition.wait(lock, [this] { return _stop || !_tasks.empty(); });
-                    if (_stop && _tasks.empty())
-                        return;
-                    task = std::move(_tasks.front());
-                    _tasks.pop();
-                }
-                task();
-            }
-        });
+namespace {
+
+thread_local ThreadPool* tlsPool    = nullptr;  ///< Pool the calling thread is a worker of.
+thread_local size_t tlsIndex         = 0;        ///< Index of the calling worker in tlsPool.
+thread_local size_t tlsStealSeed     = 0;        ///< Rotates the first steal victim.
+thread_local size_t tlsBlockingDepth = 0;        ///< Nesting depth of the calling worker's blocking regions.
+
+constexpr size_t NoCpu = static_cast<size_t>(-1);  ///< Slot whose worker is not pinned.
+
+#if MRHELPER_TRACING
+/// Wraps a job so that its queueing delay and execution are traced.
+UniqueFunction traced(UniqueFunction&& job) {
+    return [job = std::move(job), queued = Tracer::now()]() mutable {
+        Tracer::recordComplete("queued", "pool", queued, Tracer::now());
+        MRH_TRACE_SCOPE("job", "pool");
+        job();
+    };
+}
+#endif
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t numThreads, Mode mode) : _mode(mode), _stop(false) {
+    start(numThreads, numThreads, mode == Mode::NumaAware ? Topology::system() : Topology());
+}
+
+ThreadPool::ThreadPool(size_t numThreads, const Topology& topology) : _mode(Mode::NumaAware), _stop(false) {
+    start(numThreads, numThreads, topology);
+}
+
+ThreadPool::ThreadPool(const Elasticity& elasticity, Mode mode)
+    : _elasticity(elasticity), _mode(mode), _stop(false) {
+    _elasticity->minThreads = std::max<size_t>(1, _elasticity->minThreads);
+    _elasticity->maxThreads = std::max(_elasticity->minThreads, _elasticity->maxThreads);
+    start(_elasticity->maxThreads, _elasticity->minThreads,
+          mode == Mode::NumaAware ? Topology::system() : Topology());
+}
+
+void ThreadPool::start(size_t numSlots, size_t numThreads, const Topology& topology) {
+    if (_mode != Mode::SharedQueue) {
+        for (size_t i = 0; i < numSlots; ++i)
+            _locals.push_back(std::make_unique<WorkerQueue>());
+    }
+    _cpus.assign(numSlots, NoCpu);
+    if (_mode == Mode::NumaAware) {
+        // Slot i goes to node i % numNodes, so every node gets a fair share of any number of workers.
+        const auto& nodes = topology.getNodes();
+        for (size_t n = 0; n < nodes.size(); ++n)
+            _nodes.push_back(std::make_unique<NodeQueue>());
+        for (size_t i = 0; i < numSlots; ++i) {
+            const size_t node = i % nodes.size();
+            _workerNodes.push_back(node);
+            _nodes[node]->workers.push_back(i);
+            const auto& nodeCpus = nodes[node].cpus;
+            if (!nodeCpus.empty())
+                _cpus[i] = nodeCpus[(i / nodes.size()) % nodeCpus.size()];
+        }
     }
+    _workers.resize(numSlots);
+    _running.assign(numSlots, false);
+    std::lock_guard<std::mutex> lock(_queueMutex);
+    for (size_t i = 0; i < numThreads; ++i)
+        spawn(i);
+}
+
+void ThreadPool::spawn(size_t slot) {
+    // A worker that retired from the slot may still be on its way out.
+    if (_workers[slot].joinable())
+        _workers[slot].join();
+    _workers[slot] = std::thread([this, slot] {
+        if (_cpus[slot] != NoCpu)
+            Topology::pinCurrentThread(_cpus[slot]);
+        workerLoop(slot);
+    });
+    _running[slot] = true;
+    ++_numThreads;
+    MRH_TRACE_COUNTER("threads", _numThreads.load());
 }
 
 ThreadPool::~ThreadPool() {
@@ -29,21 +93,362 @@ ThreadPool::~ThreadPool() {
         _stop = true;
     }
     _condition.notify_all();
-    for (std::thread &worker : _workers)
-        worker.join();
+    for (auto& node : _nodes)
+        node->wakeup.notify_all();
+    for (std::thread &worker : _workers) {
+        if (worker.joinable())
+            worker.join();
+    }
 }
 
-bool ThreadPool::tryExecuteOne() {
-    std::function<void()> task;
+template <class Predicate>
+bool ThreadPool::sleep(size_t index, std::condition_variable& condition, std::unique_lock<std::mutex>& lock,
+                       Predicate ready) {
+    if (!_elasticity) {
+        condition.wait(lock, ready);
+        return true;
+    }
+    while (!condition.wait_for(lock, _elasticity->idleTimeout, ready)) {
+        // Only surplus workers retire, so that minThreads keep running outside blocking regions.
+        if (_numThreads - _numBlocked > _elasticity->minThreads) {
+            _running[index] = false;
+            --_numThreads;
+            ++_retired;
+            MRH_TRACE_COUNTER("threads", _numThreads.load());
+            return false;
+        }
+    }
+    return true;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    tlsPool      = this;
+    tlsIndex     = index;
+    tlsStealSeed = index;
+
+    if (_mode == Mode::SharedQueue) {
+        for (;;) {
+            Job task;
+            {
+                std::unique_lock<std::mutex> lock(_queueMutex);
+                if (!sleep(index, _condition, lock, [this] { return _stop || !_tasks.empty(); }))
+                    return;
+                if (_stop && _tasks.empty())
+                    return;
+                task = std::move(_tasks.front());
+                _tasks.pop();
+                --_injected;
+                --_pending;
+                MRH_TRACE_COUNTER("pending", _pending.load());
+            }
+            task();
+        }
+    }
+
+    for (;;) {
+        Job task;
+        if (pop(task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(_queueMutex);
+        auto ready = [this] { return _stop || _pending > 0; };
+        ++_sleepers;
+        bool running;
+        if (_nodes.empty()) {
+            running = sleep(index, _condition, lock, ready);
+        } else {
+            NodeQueue& home = *_nodes[_workerNodes[index]];
+            ++home.sleepers;
+            running = sleep(index, home.wakeup, lock, ready);
+            --home.sleepers;
+        }
+        --_sleepers;
+        if (!running || (_stop && _pending == 0))
+            return;
+    }
+}
+
+size_t ThreadPool::currentWorker() const {
+    return tlsPool == this ? tlsIndex : _workers.size();
+}
+
+void ThreadPool::push(Job&& job, size_t node) {
+#if MRHELPER_TRACING
+    job = traced(std::move(job));
+#endif
+    if (_mode != Mode::SharedQueue) {
+        if (_stop)
+            throw std::runtime_error("enqueue on stopped ThreadPool");
+        const size_t self = currentWorker();
+        if (!_nodes.empty()) {
+            // Jobs without a node stay on the worker's node; external ones are spread round-robin.
+            if (node == AnyNode)
+                node = self < _workerNodes.size() ? _workerNodes[self] : _nextNode++;
+            node %= _nodes.size();
+            if (self >= _workerNodes.size() || _workerNodes[self] != node) {
+                NodeQueue& queue = *_nodes[node];
+                {
+                    std::lock_guard<std::mutex> lock(queue.mutex);
+                    queue.jobs.push(std::move(job));
+                    ++queue.size;
+                }
+                ++_pending;
+                MRH_TRACE_COUNTER("pending", _pending.load());
+                wake(node, false);
+                return;
+            }
+        }
+        if (self < _locals.size()) {
+            {
+                std::lock_guard<std::mutex> lock(_locals[self]->mutex);
+                _locals[self]->jobs.push_back(std::move(job));
+            }
+            ++_pending;
+            MRH_TRACE_COUNTER("pending", _pending.load());
+            wake(node, false);
+            return;
+        }
+    }
     {
         std::unique_lock<std::mutex> lock(_queueMutex);
-        if (_tasks.empty())
-            return false;
-        task = std::move(_tasks.front());
-        _tasks.pop();
+        if (_stop)
+            throw std::runtime_error("enqueue on stopped ThreadPool");
+        _tasks.push(std::move(job));
+        ++_injected;
+        ++_pending;
+        MRH_TRACE_COUNTER("pending", _pending.load());
+    }
+    _condition.notify_one();
+}
+
+void ThreadPool::pushBatch(std::vector<Job>& jobs) {
+    if (jobs.empty())
+        return;
+    const size_t count = jobs.size();
+#if MRHELPER_TRACING
+    for (Job& job : jobs)
+        job = traced(std::move(job));
+#endif
+    if (_mode != Mode::SharedQueue) {
+        if (_stop)
+            throw std::runtime_error("enqueue on stopped ThreadPool");
+        const size_t self = currentWorker();
+        if (self < _locals.size()) {
+            {
+                std::lock_guard<std::mutex> lock(_locals[self]->mutex);
+                for (Job& job : jobs)
+                    _locals[self]->jobs.push_back(std::move(job));
+            }
+            jobs.clear();
+            _pending += count;
+            MRH_TRACE_COUNTER("pending", _pending.load());
+            wake(self < _workerNodes.size() ? _workerNodes[self] : AnyNode, true);
+            return;
+        }
+        if (!_nodes.empty()) {
+            const size_t node = _nextNode++ % _nodes.size();
+            NodeQueue& queue  = *_nodes[node];
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                for (Job& job : jobs)
+                    queue.jobs.push(std::move(job));
+                queue.size += count;
+            }
+            jobs.clear();
+            _pending += count;
+            MRH_TRACE_COUNTER("pending", _pending.load());
+            wake(node, true);
+            return;
+        }
     }
+    {
+        std::unique_lock<std::mutex> lock(_queueMutex);
+        if (_stop)
+            throw std::runtime_error("enqueue on stopped ThreadPool");
+        for (Job& job : jobs)
+            _tasks.push(std::move(job));
+        _injected += count;
+        _pending += count;
+        MRH_TRACE_COUNTER("pending", _pending.load());
+    }
+    jobs.clear();
+    _condition.notify_all();
+}
+
+bool ThreadPool::pop(Job& job) {
+    const size_t self = currentWorker();
+    if (_mode != Mode::SharedQueue && self < _locals.size()) {
+        WorkerQueue& local = *_locals[self];
+        std::lock_guard<std::mutex> lock(local.mutex);
+        if (!local.jobs.empty()) {
+            job = std::move(local.jobs.back());
+            local.jobs.pop_back();
+            --_pending;
+            MRH_TRACE_COUNTER("pending", _pending.load());
+            return true;
+        }
+    }
+    if (!_nodes.empty())
+        return popNuma(self, job);
+    if (_mode == Mode::SharedQueue || _injected > 0) {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        if (!_tasks.empty()) {
+            job = std::move(_tasks.front());
+            _tasks.pop();
+            --_injected;
+            --_pending;
+            MRH_TRACE_COUNTER("pending", _pending.load());
+            return true;
+        }
+    }
+    return _mode == Mode::WorkStealing && steal(self, job);
+}
+
+bool ThreadPool::popNuma(size_t self, Job& job) {
+    // Own node first: its injection queue, then its workers' deques. Other nodes are the fallback.
+    const size_t numNodes = _nodes.size();
+    const size_t home     = self < _workerNodes.size() ? _workerNodes[self] : tlsStealSeed++ % numNodes;
+    for (size_t k = 0; k < numNodes; ++k) {
+        NodeQueue& queue = *_nodes[(home + k) % numNodes];
+        if (queue.size > 0) {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.jobs.empty()) {
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop();
+                --queue.size;
+                --_pending;
+                MRH_TRACE_COUNTER("pending", _pending.load());
+                return true;
+            }
+        }
+        const size_t start = tlsStealSeed++;
+        for (size_t i = 0; i < queue.workers.size(); ++i) {
+            const size_t victim = queue.workers[(start + i) % queue.workers.size()];
+            if (victim != self && stealFrom(victim, job))
+                return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::steal(size_t self, Job& job) {
+    const size_t n = _locals.size();
+    if (n == 0)
+        return false;
+    const size_t start = tlsStealSeed++;
+    for (size_t k = 0; k < n; ++k) {
+        const size_t victim = (start + k) % n;
+        if (victim != self && stealFrom(victim, job))
+            return true;
+    }
+    return false;
+}
+
+bool ThreadPool::stealFrom(size_t victim, Job& job) {
+    WorkerQueue& queue = *_locals[victim];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty())
+        return false;
+    job = std::move(queue.jobs.front());
+    queue.jobs.pop_front();
+    --_pending;
+    MRH_TRACE_COUNTER("pending", _pending.load());
+    return true;
+}
+
+void ThreadPool::wake(size_t node, bool all) {
+    if (_sleepers > 0) {
+        // Taking the lock orders this notification after a sleeper's predicate check.
+        std::lock_guard<std::mutex> lock(_queueMutex);
+    }
+    if (_nodes.empty()) {
+        if (all)
+            _condition.notify_all();
+        else
+            _condition.notify_one();
+        return;
+    }
+    // Prefer a sleeper of the node the jobs were queued on.
+    const size_t first = node < _nodes.size() ? node : 0;
+    for (size_t k = 0; k < _nodes.size(); ++k) {
+        NodeQueue& queue = *_nodes[(first + k) % _nodes.size()];
+        if (all) {
+            queue.wakeup.notify_all();
+        } else if (queue.sleepers > 0) {
+            queue.wakeup.notify_one();
+            return;
+        }
+    }
+}
+
+bool ThreadPool::tryExecuteOne() {
+    Job task;
+    if (!pop(task))
+        return false;
     task();
     return true;
 }
 
+ThreadPool::BlockingRegion ThreadPool::blockingRegion() {
+    ThreadPool* pool = tlsPool;
+    if (!pool || !pool->_elasticity)
+        return BlockingRegion(nullptr);
+    if (tlsBlockingDepth == 0)
+        pool->enterBlocking();
+    ++tlsBlockingDepth;
+    return BlockingRegion(pool);
+}
+
+ThreadPool::BlockingRegion::~BlockingRegion() {
+    if (_pool && --tlsBlockingDepth == 0)
+        _pool->leaveBlocking();
+}
+
+void ThreadPool::enterBlocking() {
+    std::lock_guard<std::mutex> lock(_queueMutex);
+    // The caller is running and not yet blocked, so the subtraction cannot wrap.
+    if (!_stop && _numThreads - _numBlocked - 1 < _elasticity->minThreads &&
+        _numThreads < _elasticity->maxThreads) {
+        const size_t slot = std::find(_running.begin(), _running.end(), false) - _running.begin();
+        spawn(slot);
+        ++_spawned;
+    }
+    ++_numBlocked;
+}
+
+void ThreadPool::leaveBlocking() {
+    --_numBlocked;
+}
+
+size_t ThreadPool::getNumThreads() const {
+    return _numThreads;
+}
+
+bool ThreadPool::isElastic() const {
+    return _elasticity.has_value();
+}
+
+ThreadPool::Stats ThreadPool::getStats() const {
+    Stats stats;
+    stats.numThreads = _numThreads;
+    stats.numBlocked = _numBlocked;
+    stats.spawned    = _spawned;
+    stats.retired    = _retired;
+    return stats;
+}
+
+ThreadPool::Mode ThreadPool::getMode() const {
+    return _mode;
+}
+
+size_t ThreadPool::getNumNodes() const {
+    return _nodes.empty() ? 1 : _nodes.size();
+}
+
+size_t ThreadPool::getCurrentNode() const {
+    const size_t self = currentWorker();
+    return self < _workerNodes.size() ? _workerNodes[self] : AnyNode;
+}
+
 }  // namespace mrh
@@ -0,0 +1,159 @@
+#include "MRHelper/Topology.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace mrh {
+
+namespace {
+
+/// Returns a single node holding the CPUs 0 to hardware_concurrency() - 1.
+std::vector<Topology::Node> singleNode() {
+    Topology::Node node{0, {}};
+    for (size_t cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu)
+        node.cpus.push_back(cpu);
+    return {std::move(node)};
+}
+
+/// CPU numbers from this on are treated as malformed, so a corrupt range cannot run away.
+constexpr size_t MaxCpus = size_t(1) << 16;
+
+}  // namespace
+
+Topology::Topology() : _nodes{Node{0, {}}} {}
+
+Topology::Topology(std::vector<Node> nodes) {
+    for (Node& node : nodes) {
+        if (!node.cpus.empty())
+            _nodes.push_back(std::move(node));
+    }
+    if (_nodes.empty())
+        _nodes.push_back(Node{0, {}});
+    std::sort(_nodes.begin(), _nodes.end(), [](const Node& lhs, const Node& rhs) { return lhs.id < rhs.id; });
+}
+
+Topology Topology::fromSysfs(const std::filesystem::path& directory) {
+    std::vector<Node> nodes;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        const std::string name = it->path().filename().string();
+        if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+            !std::all_of(name.begin() + 4, name.end(), [](unsigned char c) { return std::isdigit(c); }))
+            continue;
+        std::ifstream in(it->path() / "cpulist");
+        std::string list;
+        if (!in || !std::getline(in, list))
+            continue;
+        try {
+            nodes.push_back(Node{std::stoul(name.substr(4)), parseCpuList(list)});
+        } catch (const std::out_of_range&) {
+            // Node number too large for size_t; not a node the kernel would create.
+        }
+    }
+    return Topology(std::move(nodes));
+}
+
+const Topology& Topology::system() {
+    static const Topology instance = [] {
+#ifdef _WIN32
+        std::vector<Node> nodes;
+        ULONG highest = 0;
+        if (GetNumaHighestNodeNumber(&highest)) {
+            for (ULONG id = 0; id <= highest && id <= 0xff; ++id) {
+                ULONGLONG mask = 0;
+                if (!GetNumaNodeProcessorMask(static_cast<UCHAR>(id), &mask))
+                    continue;
+                Node node{id, {}};
+                for (size_t cpu = 0; cpu < 64; ++cpu) {
+                    if (mask & (1ull << cpu))
+                        node.cpus.push_back(cpu);
+                }
+                nodes.push_back(std::move(node));
+            }
+        }
+        Topology topology(std::move(nodes));
+#elif defined(__linux__)
+        Topology topology = fromSysfs("/sys/devices/system/node");
+        // Keep only the CPUs the process may run on, e.g. inside a cpuset.
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+            auto isDenied = [&allowed](size_t cpu) {
+                return cpu >= static_cast<size_t>(CPU_SETSIZE) || !CPU_ISSET(cpu, &allowed);
+            };
+            std::vector<Node> nodes;
+            for (Node node : topology.getNodes()) {
+                node.cpus.erase(std::remove_if(node.cpus.begin(), node.cpus.end(), isDenied), node.cpus.end());
+                nodes.push_back(std::move(node));
+            }
+            topology = Topology(std::move(nodes));
+        }
+#else
+        Topology topology;
+#endif
+        return topology.getNodes().front().cpus.empty() ? Topology(singleNode()) : topology;
+    }();
+    return instance;
+}
+
+std::vector<size_t> Topology::parseCpuList(const std::string& list) {
+    std::vector<size_t> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos)
+            end = list.size();
+        const std::string range = list.substr(pos, end - pos);
+        pos                     = end + 1;
+
+        const size_t dash = range.find('-');
+        try {
+            const size_t first = std::stoul(range.substr(0, dash));
+            const size_t last  = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+            if (last >= MaxCpus)
+                continue;
+            for (size_t cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        } catch (const std::logic_error&) {
+            // Blank or malformed range, e.g. the trailing newline of an empty list.
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+bool Topology::pinCurrentThread(size_t cpu) {
+#ifdef _WIN32
+    if (cpu >= 8 * sizeof(DWORD_PTR))
+        return false;
+    return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu) != 0;
+#elif defined(__linux__)
+    if (cpu >= static_cast<size_t>(CPU_SETSIZE))
+        return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+}  // namespace mrh
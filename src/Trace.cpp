@@ -0,0 +1,197 @@
+#include "MRHelper/Trace.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mrh {
+
+namespace {
+
+/// Fixed-size block of events, appended to by one thread and read by any.
+struct Chunk {
+    static constexpr size_t Capacity = 4096;  ///< Events per chunk.
+
+    Tracer::Event events[Capacity];     ///< Events; the first `size` are published.
+    std::atomic<size_t> size{0};        ///< Number of published events.
+    std::atomic<Chunk*> next{nullptr};  ///< Following chunk of the same thread.
+};
+
+/// Events of one thread, in recording order.
+struct ThreadBuffer {
+    explicit ThreadBuffer(size_t id) : id(id), head(std::make_unique<Chunk>()), tail(head.get()) {}
+
+    ~ThreadBuffer() {
+        for (Chunk* chunk = head->next.load(); chunk;) {
+            Chunk* next = chunk->next.load();
+            delete chunk;
+            chunk = next;
+        }
+    }
+
+    /// Appends an event; only called by the owning thread.
+    void append(const Tracer::Event& event) {
+        size_t n = tail->size.load(std::memory_order_relaxed);
+        if (n == Chunk::Capacity) {
+            Chunk* chunk = new Chunk();
+            tail->next.store(chunk, std::memory_order_release);
+            tail = chunk;
+            n    = 0;
+        }
+        tail->events[n] = event;
+        tail->size.store(n + 1, std::memory_order_release);
+    }
+
+    size_t id;                    ///< Thread id shown in the trace.
+    std::unique_ptr<Chunk> head;  ///< First chunk.
+    Chunk* tail;                  ///< Chunk being appended to.
+};
+
+/// Buffers of all threads that have recorded; they outlive their threads so the events can be exported.
+struct Registry {
+    std::mutex mutex;                                    ///< Protects buffers and idle.
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;  ///< One buffer per concurrently recording thread.
+    std::vector<ThreadBuffer*> idle;                     ///< Buffers of exited threads, reused by new ones.
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+/// Binds a buffer to the current thread and returns it to the registry when the thread exits.
+struct BufferLease {
+    BufferLease() {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        if (!reg.idle.empty()) {
+            // Threads of elastic pools come and go; reusing buffers bounds their number by the peak thread count.
+            buffer = reg.idle.back();
+            reg.idle.pop_back();
+        } else {
+            reg.buffers.push_back(std::make_unique<ThreadBuffer>(reg.buffers.size() + 1));
+            buffer = reg.buffers.back().get();
+        }
+    }
+
+    ~BufferLease() {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.idle.push_back(buffer);
+    }
+
+    BufferLease(const BufferLease&)            = delete;
+    BufferLease& operator=(const BufferLease&) = delete;
+
+    ThreadBuffer* buffer = nullptr;  ///< Buffer of the current thread.
+};
+
+ThreadBuffer& localBuffer() {
+    thread_local BufferLease lease;
+    return *lease.buffer;
+}
+
+/// Writes a string as a JSON string literal.
+void writeString(std::ostream& out, const char* str) {
+    out << '"';
+    for (; *str; ++str) {
+        if (*str == '"' || *str == '\\')
+            out << '\\';
+        out << *str;
+    }
+    out << '"';
+}
+
+/// Writes a time in nanoseconds as the microseconds Chrome traces use.
+void writeMicros(std::ostream& out, uint64_t nanos) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%llu.%03u", static_cast<unsigned long long>(nanos / 1000),
+                  static_cast<unsigned>(nanos % 1000));
+    out << buffer;
+}
+
+}  // namespace
+
+void Tracer::record(Phase phase, const char* name, const char* category, const char* argName, int64_t argValue) {
+    if constexpr (Enabled)
+        localBuffer().append(Event{name, category, argName, argValue, now(), 0, phase});
+}
+
+void Tracer::recordComplete(const char* name, const char* category, uint64_t start, uint64_t end) {
+    if constexpr (Enabled)
+        localBuffer().append(Event{name, category, nullptr, 0, start, end - start, Phase::Complete});
+}
+
+uint64_t Tracer::now() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+size_t Tracer::getNumEvents() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    size_t count = 0;
+    for (const auto& buffer : reg.buffers) {
+        for (const Chunk* chunk = buffer->head.get(); chunk; chunk = chunk->next.load(std::memory_order_acquire))
+            count += chunk->size.load(std::memory_order_acquire);
+    }
+    return count;
+}
+
+void Tracer::writeChromeTrace(std::ostream& out) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& buffer : reg.buffers) {
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+            << ",\"args\":{\"name\":\"thread " << buffer->id << "\"}}";
+        first = false;
+        for (const Chunk* chunk = buffer->head.get(); chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+            const size_t size = chunk->size.load(std::memory_order_acquire);
+            for (size_t i = 0; i < size; ++i) {
+                const Event& event = chunk->events[i];
+                out << ",\n{\"name\":";
+                writeString(out, event.name);
+                out << ",\"cat\":";
+                writeString(out, event.category);
+                out << ",\"ph\":\"" << static_cast<char>(event.phase) << "\",\"pid\":1,\"tid\":" << buffer->id
+                    << ",\"ts\":";
+                writeMicros(out, event.timestamp);
+                if (event.phase == Phase::Complete) {
+                    out << ",\"dur\":";
+                    writeMicros(out, event.duration);
+                } else if (event.phase == Phase::Instant) {
+                    out << ",\"s\":\"t\"";
+                }
+                if (event.argName) {
+                    out << ",\"args\":{";
+                    writeString(out, event.argName);
+                    out << ':' << event.argValue << '}';
+                }
+                out << '}';
+            }
+        }
+    }
+    out << "\n]}" << std::endl;
+}
+
+void Tracer::clear() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const auto& buffer : reg.buffers) {
+        for (Chunk* chunk = buffer->head->next.exchange(nullptr); chunk;) {
+            Chunk* next = chunk->next.load();
+            delete chunk;
+            chunk = next;
+        }
+        buffer->head->size.store(0);
+        buffer->tail = buffer->head.get();
+    }
+}
+
+}  // namespace mrh
@@ -1,15 +1,344 @@
+#include <algorithm>
 #include <any>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <typeinfo>
 #include <vector>
 
+#include "MRHelper/Cancellation.hpp"
+#include "MRHelper/Channel.hpp"
+#if MRHELPER_COROUTINES
+#include "MRHelper/CoroutineTask.hpp"
+#endif
+#include "MRHelper/MapArena.hpp"
 #include "MRHelper/MapReduceTask.hpp"
+#include "MRHelper/MappedFileSource.hpp"
+#include "MRHelper/ProcessExecutor.hpp"
+#include "MRHelper/ResultStore.hpp"
 #include "MRHelper/Scheduler.hpp"
 #include "MRHelper/SimpleTask.hpp"
+#include "MRHelper/StaticMapReduceTask.hpp"
 #include "MRHelper/Task.hpp"
+#include "MRHelper/TaskGroup.hpp"
 #include "MRHelper/ThreadPool.hpp"
+#include "MRHelper/Topology.hpp"
+#include "MRHelper/Trace.hpp"
+#include "MRHelper/TypedTask.hpp"
+#include "MRHelper/UniqueFunction.hpp"
+
+void testThreadPoolModes() {
+    std::cout << "Running testThreadPoolModes..." << std::endl;
+    for (auto mode : {mrh::ThreadPool::Mode::SharedQueue, mrh::ThreadPool::Mode::WorkStealing,
+                      mrh::ThreadPool::Mode::NumaAware}) {
+        mrh::ThreadPool pool(3, mode);
+        assert(pool.getMode() == mode);
+        assert(pool.getNumThreads() == 3);
+        std::atomic<int> done{0};
+        std::vector<std::future<int>> parents;
+        for (int i = 0; i < 8; ++i) {
+            parents.push_back(pool.enqueue([&pool, &done, i]() {
+                std::vector<std::future<int>> children;
+                for (int c = 0; c < 100; ++c)
+                    children.push_back(pool.enqueue([&done](int v) { return ++done, v; }, c));
+                int sum = 0;
+                for (auto& child : children) {
+                    while (child.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready)
+                        pool.tryExecuteOne();
+                    sum += child.get();
+                }
+                return sum + i;
+            }));
+        }
+        int total = 0;
+        for (auto& parent : parents)
+            total += parent.get();
+        assert(done == 800);
+        assert(total == 8 * 4950 + 28);
+
+        auto failing = pool.enqueue([]() -> int { throw std::runtime_error("boom"); });
+        bool thrown  = false;
+        try {
+            failing.get();
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+    std::cout << "testThreadPoolModes passed." << std::endl;
+}
+
+void testThreadPoolSubmission() {
+    std::cout << "Running testThreadPoolSubmission..." << std::endl;
+    // Move-only callables, inline and heap-stored.
+    auto owned = std::make_unique<int>(7);
+    mrh::UniqueFunction small([p = std::move(owned)]() { assert(*p == 7); });
+    struct Large {
+        char data[128];
+        void operator()() const { assert(data[127] == 'x'); }
+    } large;
+    std::fill(std::begin(large.data), std::end(large.data), 'x');
+    static_assert(!mrh::UniqueFunction::fitsInline<Large>(), "Large must be heap-stored");
+    mrh::UniqueFunction heap(large);
+    mrh::UniqueFunction moved = std::move(small);
+    assert(!small);
+    moved();
+    heap();
+
+    mrh::ThreadPool pool(2);
+    auto withArgs = pool.enqueue([](int a, const std::string& b) { return b + std::to_string(a); }, 5, "x");
+    auto moveOnly = pool.enqueue([p = std::make_unique<int>(3)]() { return *p; });
+    const std::string joined = withArgs.get();
+    const int fromMoveOnly   = moveOnly.get();
+    assert(joined == "x5" && fromMoveOnly == 3);
+
+    std::atomic<int> posted{0};
+    for (int i = 0; i < 100; ++i)
+        pool.post([&posted]() { ++posted; });
+
+    std::vector<std::function<int()>> batch;
+    for (int i = 0; i < 50; ++i)
+        batch.push_back([i]() { return i * i; });
+    auto futures = pool.enqueueBatch(batch.begin(), batch.end());
+    assert(futures.size() == 50);
+    for (int i = 0; i < 50; ++i) {
+        const int square = futures[i].get();
+        assert(square == i * i);
+    }
+    while (posted < 100)
+        pool.tryExecuteOne();
+
+    // A worker posting while the pool shuts down is rejected like an external thread.
+    std::atomic<bool> stopping{false}, rejected{false};
+    {
+        mrh::ThreadPool stopped(1);
+        stopped.post([&stopped, &stopping, &rejected]() {
+            while (!stopping)
+                std::this_thread::yield();
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            try {
+                stopped.post([]() {});
+            } catch (const std::runtime_error&) {
+                rejected = true;
+            }
+        });
+        stopping = true;
+    }
+    assert(rejected);
+    std::cout << "testThreadPoolSubmission passed." << std::endl;
+}
+
+void testThreadPoolTopology() {
+    std::cout << "Running testThreadPoolTopology..." << std::endl;
+    assert((mrh::Topology::parseCpuList("0-3,8,10-11\n") == std::vector<size_t>{0, 1, 2, 3, 8, 10, 11}));
+    assert(mrh::Topology::parseCpuList("\n").empty());
+    // Reversed, overflowing and runaway ranges are skipped.
+    const auto malformed = mrh::Topology::parseCpuList("3-1,99999999999999999999,0-18446744073709551615,2");
+    assert((malformed == std::vector<size_t>{2}));
+
+    // A fake sysfs tree with two nodes, a memory-only node and unrelated entries.
+    const auto directory = std::filesystem::temp_directory_path() / "mrh_topology_test";
+    std::filesystem::remove_all(directory);
+    for (const char* node : {"node0", "node1", "node3", "node99999999999999999999", "power"})
+        std::filesystem::create_directories(directory / node);
+    std::ofstream(directory / "node0" / "cpulist") << "0-1,4\n";
+    std::ofstream(directory / "node99999999999999999999" / "cpulist") << "5\n";
+    std::ofstream(directory / "node1" / "cpulist") << "2-3\n";
+    std::ofstream(directory / "node3" / "cpulist") << "\n";
+    std::ofstream(directory / "possible") << "0-1,3\n";
+    const mrh::Topology fake = mrh::Topology::fromSysfs(directory);
+    std::filesystem::remove_all(directory);
+    assert(fake.getNumNodes() == 2);
+    assert(fake.getNodes()[0].id == 0 && (fake.getNodes()[0].cpus == std::vector<size_t>{0, 1, 4}));
+    assert(fake.getNodes()[1].id == 1 && (fake.getNodes()[1].cpus == std::vector<size_t>{2, 3}));
+    assert(mrh::Topology::fromSysfs(directory).getNumNodes() == 1);
+    assert(!mrh::Topology::system().getNodes().front().cpus.empty());
+
+    // Two nodes sharing CPU 0, so the workers can be pinned on any machine.
+    mrh::ThreadPool pool(4, mrh::Topology({{0, {0}}, {1, {0}}}));
+    assert(pool.getMode() == mrh::ThreadPool::Mode::NumaAware);
+    assert(pool.getNumNodes() == 2);
+    assert(pool.getCurrentNode() == mrh::ThreadPool::AnyNode);
+    std::atomic<int> valid{0};
+    {
+        mrh::TaskGroup group(pool);
+        for (size_t i = 0; i < 200; ++i) {
+            group.runOnNode(i % 2, [&pool, &valid]() {
+                // Workers report their node; the waiter, which may claim children too, reports AnyNode.
+                const size_t node = pool.getCurrentNode();
+                if (node < 2 || node == mrh::ThreadPool::AnyNode)
+                    ++valid;
+            });
+        }
+        group.wait();
+    }
+    assert(valid == 200);
+    std::atomic<int> posted{0};
+    for (int i = 0; i < 100; ++i)
+        pool.postToNode(mrh::ThreadPool::AnyNode, [&posted]() { ++posted; });
+    while (posted < 100)
+        pool.tryExecuteOne();
+    assert(mrh::ThreadPool(2).getNumNodes() == 1);
+
+    // MapReduce results do not depend on the placement.
+    auto source = std::make_shared<mrh::TypedTask<std::vector<int>>>([](const mrh::TaskInputs&) {
+        std::vector<int> vec(20000);
+        for (int i = 0; i < 20000; ++i)
+            vec[i] = (i * 7919) % 5000;
+        return vec;
+    });
+    using Task = mrh::MapReduceTask<std::vector<int>, int, int, int, mrh::RangeSplitter<std::vector<int>>>;
+    auto count = std::make_shared<Task>(
+        [](const Task::Shard& shard) {
+            std::vector<std::pair<int, int>> out;
+            for (int v : shard)
+                out.emplace_back(v, 1);
+            return out;
+        },
+        [](const int&, const std::vector<int>& values) { return static_cast<int>(values.size()); }, 7, false);
+    count->setNumPartitions(5);
+    count->dependsOn(source);
+    auto result = std::any_cast<Task::SortedResult>(count->execute(pool));
+    assert(result.size() == 5000);
+    for (const auto& kv : result)
+        assert(kv.second == 4);
+    std::cout << "testThreadPoolTopology passed." << std::endl;
+}
+
+void testThreadPoolElastic() {
+    std::cout << "Running testThreadPoolElastic..." << std::endl;
+    mrh::ThreadPool::Elasticity elasticity;
+    elasticity.minThreads  = 2;
+    elasticity.maxThreads  = 4;
+    elasticity.idleTimeout = std::chrono::milliseconds(20);
+    mrh::ThreadPool pool(elasticity);
+    assert(pool.isElastic() && pool.getNumThreads() == 2);
+
+    // Blocked workers are compensated up to maxThreads; nested regions count once.
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    std::atomic<int> blocked{0};
+    std::vector<std::future<void>> blockers;
+    for (int i = 0; i < 3; ++i) {
+        blockers.push_back(pool.enqueue([&blocked, opened]() {
+            auto region = mrh::ThreadPool::blockingRegion();
+            {
+                auto nested = mrh::ThreadPool::blockingRegion();
+                ++blocked;
+            }
+            opened.wait();
+        }));
+    }
+    while (blocked < 3)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    mrh::ThreadPool::Stats stats = pool.getStats();
+    assert(stats.numThreads == 4 && stats.numBlocked == 3 && stats.spawned == 2);
+    const int direct = pool.enqueue([]() { return 5; }).get();
+    assert(direct == 5);
+    gate.set_value();
+    for (auto& blocker : blockers)
+        blocker.get();
+
+    // Surplus workers retire once idle.
+    for (int i = 0; i < 5000 && pool.getNumThreads() > 2; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    stats = pool.getStats();
+    assert(stats.numThreads == 2 && stats.numBlocked == 0 && stats.retired == 2);
+
+    // Regions are no-ops outside elastic pools.
+    {
+        auto region = mrh::ThreadPool::blockingRegion();
+    }
+    mrh::ThreadPool fixed(1);
+    fixed.enqueue([]() { auto region = mrh::ThreadPool::blockingRegion(); }).get();
+    assert(!fixed.isElastic() && fixed.getStats().spawned == 0 && fixed.getNumThreads() == 1);
+
+    // A Scheduler on an elastic pool, with tasks that block on a shared dependency.
+    mrh::Scheduler scheduler(elasticity);
+    auto source = std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>&) -> std::any {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return 1;
+    });
+    auto sum = std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>& inputs) -> std::any {
+        int total = 0;
+        for (const auto& input : inputs)
+            total += std::any_cast<int>(input);
+        return total;
+    });
+    for (int i = 0; i < 4; ++i) {
+        // Readers racing for the source wait in a blocking region until the first one has computed it.
+        auto reader = std::make_shared<mrh::SimpleTask>([source, &fixed](const std::vector<std::any>&) -> std::any {
+            return std::any_cast<int>(source->execute(fixed)) + 1;
+        });
+        sum->dependsOn(reader);
+    }
+    std::any total = scheduler.execute(sum);
+    assert(std::any_cast<int>(total) == 8);
+    std::cout << "testThreadPoolElastic passed." << std::endl;
+}
+
+void testTaskGroup() {
+    std::cout << "Running testTaskGroup..." << std::endl;
+    mrh::ThreadPool pool(1);
+
+    // Block the only worker so the waiter has to run the group's children itself.
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    auto blocker                      = pool.enqueue([released]() { released.wait(); });
+    std::thread::id unrelatedThread;
+    auto unrelated = pool.enqueue([&unrelatedThread]() { unrelatedThread = std::this_thread::get_id(); });
+
+    std::atomic<int> done{0};
+    mrh::TaskGroup group(pool);
+    for (int i = 0; i < 10; ++i) {
+        group.run([&group, &done]() {
+            ++done;
+            group.run([&done]() { ++done; });
+        });
+    }
+    group.wait();
+    assert(done == 20);
+
+    release.set_value();
+    blocker.get();
+    unrelated.get();
+    assert(unrelatedThread != std::this_thread::get_id());
+
+    // Nested groups and exception propagation.
+    group.run([&pool, &done]() {
+        mrh::TaskGroup inner(pool);
+        for (int i = 0; i < 5; ++i)
+            inner.run([&done]() { ++done; });
+        inner.wait();
+    });
+    group.run([]() { throw std::runtime_error("child failed"); });
+    bool thrown = false;
+    try {
+        group.wait();
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(done == 25);
+    group.wait();
+    std::cout << "testTaskGroup passed." << std::endl;
+}
 
 void testSimpleTaskCaching() {
     std::cout << "Running testSimpleTaskCaching..." << std::endl;
@@ -74,6 +403,720 @@ void testMapReduceTask() {
     std::cout << "testMapReduceTask passed." << std::endl;
 }
 
+void testMapReduceRangeSplitter() {
+    std::cout << "Running testMapReduceRangeSplitter..." << std::endl;
+    auto source = std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>& inputs) -> std::any {
+        std::vector<int> vec(1000);
+        for (int i = 0; i < 1000; ++i)
+            vec[i] = i + 1;
+        return vec;
+    });
+    using Task = mrh::MapReduceTask<std::vector<int>, std::string, int, int, mrh::RangeSplitter<std::vector<int>>>;
+    std::atomic<int> mapCalls{0};
+    auto mapFunc = [&mapCalls](const Task::Shard& shard) -> std::vector<std::pair<std::string, int>> {
+        ++mapCalls;
+        int sum = 0;
+        for (int v : shard)
+            sum += v;
+        return {{"sum", sum}, {"count", static_cast<int>(shard.size())}};
+    };
+    auto reduceFunc = [](const std::string& key, const std::vector<int>& values) -> int {
+        int total = 0;
+        for (int v : values)
+            total += v;
+        return total;
+    };
+    auto task = std::make_shared<Task>(mapFunc, reduceFunc, 4);
+    task->dependsOn(source);
+
+    mrh::ThreadPool pool(2);
+    auto resMap = std::any_cast<std::map<std::string, int>>(task->execute(pool));
+    assert(mapCalls == 4);
+    assert(resMap["sum"] == 500500);
+    assert(resMap["count"] == 1000);
+    std::cout << "testMapReduceRangeSplitter passed." << std::endl;
+}
+
+void testMapReduceDelimitedSplitter() {
+    std::cout << "Running testMapReduceDelimitedSplitter..." << std::endl;
+    std::string text;
+    for (int i = 0; i < 100; ++i)
+        text += (i % 2 ? "foo bar\n" : "baz\n");
+
+    mrh::DelimitedSplitter<std::string> splitter;
+    auto shards = splitter.split(text, 7);
+    assert(shards.size() <= 7);
+    size_t covered = 0;
+    for (auto shard : shards) {
+        assert(shard.data() == text.data() + covered);
+        assert(shard.back() == '\n');
+        covered += shard.size();
+    }
+    assert(covered == text.size());
+
+    auto source = std::make_shared<mrh::SimpleTask>([text](const std::vector<std::any>& inputs) -> std::any {
+        return text;
+    });
+    using Task = mrh::MapReduceTask<std::string, std::string, int, int, mrh::DelimitedSplitter<std::string>>;
+    auto mapFunc = [](const std::string_view& shard) -> std::vector<std::pair<std::string, int>> {
+        std::vector<std::pair<std::string, int>> out;
+        mrh::DelimitedSplitter<std::string>::forEachRecord(shard, '\n', [&out](std::string_view line) {
+            mrh::DelimitedSplitter<std::string>::forEachRecord(line, ' ', [&out](std::string_view word) {
+                out.emplace_back(std::string(word), 1);
+            });
+        });
+        return out;
+    };
+    auto reduceFunc = [](const std::string& key, const std::vector<int>& values) -> int {
+        return static_cast<int>(values.size());
+    };
+    auto task = std::make_shared<Task>(mapFunc, reduceFunc, 5);
+    task->dependsOn(source);
+
+    mrh::ThreadPool pool(2);
+    auto resMap = std::any_cast<std::map<std::string, int>>(task->execute(pool));
+    assert(resMap.size() == 3);
+    assert(resMap["foo"] == 50);
+    assert(resMap["bar"] == 50);
+    assert(resMap["baz"] == 50);
+    std::cout << "testMapReduceDelimitedSplitter passed." << std::endl;
+}
+
+void testMappedFileSource() {
+    std::cout << "Running testMappedFileSource..." << std::endl;
+    const auto dir   = std::filesystem::temp_directory_path();
+    const auto first = dir / "mrh-mapped-test-1.txt";
+    const auto empty = dir / "mrh-mapped-test-2.txt";
+    const auto last  = dir / "mrh-mapped-test-3.txt";
+    {
+        std::ofstream out(first, std::ios::binary);
+        for (int i = 0; i < 300; ++i)
+            out << (i % 3 ? "foo;" : "bar;");
+        std::ofstream(empty, std::ios::binary);
+        std::ofstream(last, std::ios::binary) << "foo;baz";
+    }
+
+    auto source = std::make_shared<mrh::MappedFileSource>(std::vector<std::filesystem::path>{first, empty, last}, ';');
+    mrh::ThreadPool pool(2);
+    auto files = source->executeTyped(pool);
+    assert(files->getFiles().size() == 3);
+    assert(files->getTotalSize() == 1200 + 7);
+
+    // Shards are record-aligned views into the mappings and never span files.
+    auto shards = mrh::MappedFileSplitter().split(*files, 8);
+    size_t covered = 0;
+    for (auto shard : shards) {
+        assert(shard.back() == ';' || shard == "foo;baz");
+        covered += shard.size();
+    }
+    assert(covered == files->getTotalSize());
+
+    using Task   = mrh::MapReduceTask<mrh::MappedFiles, std::string, int, int, mrh::MappedFileSplitter>;
+    auto mapFunc = [](const std::string_view& shard) -> std::vector<std::pair<std::string, int>> {
+        std::vector<std::pair<std::string, int>> out;
+        mrh::DelimitedSplitter<>::forEachRecord(shard, ';', [&out](std::string_view record) {
+            out.emplace_back(std::string(record), 1);
+        });
+        return out;
+    };
+    auto reduceFunc = [](const std::string& key, const std::vector<int>& values) -> int {
+        return static_cast<int>(values.size());
+    };
+    auto task = std::make_shared<Task>(mapFunc, reduceFunc, 4);
+    task->dependsOn(source);
+    auto resMap = std::any_cast<Task::SortedResult>(task->execute(pool));
+    assert(resMap.size() == 3);
+    assert(resMap["foo"] == 201);
+    assert(resMap["bar"] == 100);
+    assert(resMap["baz"] == 1);
+
+    bool threw = false;
+    try {
+        mrh::MappedFile missing(dir / "mrh-mapped-test-missing.txt");
+    } catch (const std::system_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    source.reset();
+    task.reset();
+    files = {};
+    std::filesystem::remove(first);
+    std::filesystem::remove(empty);
+    std::filesystem::remove(last);
+    std::cout << "testMappedFileSource passed." << std::endl;
+}
+
+void testMapReduceCombiner() {
+    std::cout << "Running testMapReduceCombiner..." << std::endl;
+    auto source = std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>& inputs) -> std::any {
+        std::vector<int> vec(10000);
+        for (int i = 0; i < 10000; ++i)
+            vec[i] = i;
+        return vec;
+    });
+    using Task   = mrh::MapReduceTask<std::vector<int>, int, long, long, mrh::RangeSplitter<std::vector<int>>>;
+    auto mapFunc = [](const Task::Shard& shard) -> std::vector<std::pair<int, long>> {
+        std::vector<std::pair<int, long>> out;
+        for (int v : shard)
+            out.emplace_back(v % 7, v);
+        return out;
+    };
+    std::atomic<size_t> maxGroupSize{0};
+    auto sumFunc = [](const int& key, const std::vector<long>& values) -> long {
+        long sum = 0;
+        for (long v : values)
+            sum += v;
+        return sum;
+    };
+    auto reduceFunc = [&maxGroupSize, sumFunc](const int& key, const std::vector<long>& values) -> long {
+        size_t prev = maxGroupSize;
+        while (prev < values.size() && !maxGroupSize.compare_exchange_weak(prev, values.size())) {
+        }
+        return sumFunc(key, values);
+    };
+
+    mrh::ThreadPool pool(2);
+    auto plain = std::make_shared<Task>(mapFunc, reduceFunc, 4);
+    plain->dependsOn(source);
+    auto expected = std::any_cast<std::map<int, long>>(plain->execute(pool));
+    assert(maxGroupSize > 4);
+
+    maxGroupSize  = 0;
+    auto combined = std::make_shared<Task>(mapFunc, reduceFunc, 4);
+    combined->setCombiner(sumFunc);
+    combined->dependsOn(source);
+    auto actual = std::any_cast<std::map<int, long>>(combined->execute(pool));
+    assert(maxGroupSize <= 4);
+    assert(actual == expected);
+    assert(expected.size() == 7);
+    std::cout << "testMapReduceCombiner passed." << std::endl;
+}
+
+void testMapReducePartitionedShuffle() {
+    std::cout << "Running testMapReducePartitionedShuffle..." << std::endl;
+    auto source = std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>& inputs) -> std::any {
+        std::vector<int> vec(20000);
+        for (int i = 0; i < 20000; ++i)
+            vec[i] = (i * 7919) % 5000;
+        return vec;
+    });
+    using Task   = mrh::MapReduceTask<std::vector<int>, int, int, int, mrh::RangeSplitter<std::vector<int>>>;
+    auto mapFunc = [](const Task::Shard& shard) -> std::vector<std::pair<int, int>> {
+        std::vector<std::pair<int, int>> out;
+        for (int v : shard)
+            out.emplace_back(v, 1);
+        return out;
+    };
+    auto reduceFunc = [](const int& key, const std::vector<int>& values) -> int {
+        return static_cast<int>(values.size());
+    };
+
+    mrh::ThreadPool pool(2);
+    auto sorted = std::make_shared<Task>(mapFunc, reduceFunc, 3);
+    sorted->setNumPartitions(5);
+    sorted->dependsOn(source);
+    auto expected = std::any_cast<Task::SortedResult>(sorted->execute(pool));
+    assert(expected.size() == 5000);
+    for (const auto& kv : expected)
+        assert(kv.second == 4);
+
+    std::atomic<int> badPartition{0};
+    auto unsorted = std::make_shared<Task>(mapFunc, reduceFunc, 3);
+    unsorted->setNumPartitions(8);
+    unsorted->setPartitioner([&badPartition](const int& key, size_t numPartitions) -> size_t {
+        if (numPartitions != 8)
+            ++badPartition;
+        return static_cast<size_t>(key) / 625;
+    });
+    unsorted->setSortedOutput(false);
+    unsorted->dependsOn(source);
+    auto list = std::any_cast<Task::UnsortedResult>(unsorted->execute(pool));
+    assert(badPartition == 0);
+    assert(list.size() == expected.size());
+    // The range partitioner keeps keys of one partition together, partitions in order.
+    for (size_t i = 1; i < list.size(); ++i)
+        assert(list[i - 1].first / 625 <= list[i].first / 625);
+    assert(Task::SortedResult(list.begin(), list.end()) == expected);
+
+    // A partition index out of range is reported instead of corrupting the buckets.
+    auto outOfRange = std::make_shared<Task>(mapFunc, reduceFunc, 3);
+    outOfRange->setNumPartitions(4);
+    outOfRange->setPartitioner([](const int&, size_t numPartitions) { return numPartitions; });
+    outOfRange->dependsOn(source);
+    bool thrown = false;
+    try {
+        outOfRange->execute(pool);
+    } catch (const std::out_of_range&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // Keys without std::hash are grouped by sorting, with and without a combiner and a partitioner.
+    using PairKey  = std::pair<int, int>;
+    using PairTask = mrh::MapReduceTask<std::vector<int>, PairKey, int, int, mrh::RangeSplitter<std::vector<int>>>;
+    auto pairMap   = [](const PairTask::Shard& shard) -> std::vector<std::pair<PairKey, int>> {
+        std::vector<std::pair<PairKey, int>> out;
+        for (int v : shard)
+            out.emplace_back(PairKey(v % 50, v % 3), 1);
+        return out;
+    };
+    auto pairReduce = [](const PairKey&, const std::vector<int>& values) {
+        int total = 0;
+        for (int v : values)
+            total += v;
+        return total;
+    };
+    auto pairs = std::make_shared<PairTask>(pairMap, pairReduce, 3);
+    pairs->dependsOn(source);
+    auto pairCounts = std::any_cast<PairTask::SortedResult>(pairs->execute(pool));
+    pairs->setCombiner(pairReduce);
+    pairs->setPartitioner([](const PairKey& key, size_t numPartitions) { return key.first % numPartitions; });
+    pairs->setNumPartitions(3);
+    pairs->invalidate();
+    auto pairCombined = std::any_cast<PairTask::SortedResult>(pairs->execute(pool));
+    assert(pairCounts.size() == 150 && pairCombined == pairCounts);
+    int pairTotal = 0;
+    for (const auto& kv : pairCounts)
+        pairTotal += kv.second;
+    assert(pairTotal == 20000);
+    std::cout << "testMapReducePartitionedShuffle passed." << std::endl;
+}
+
+void testMapReduceReduceChunks() {
+    std::cout << "Running testMapReduceReduceChunks..." << std::endl;
+    using Task   = mrh::MapReduceTask<std::vector<int>, int, std::string, std::string>;
+    auto mapFunc = [](const std::vector<int>& input) -> std::vector<std::pair<int, std::string>> {
+        std::vector<std::pair<int, std::string>> out;
+        for (int i = 0; i < 3000; ++i)
+            out.emplace_back(i % 1000, std::to_string(i / 1000));
+        return out;
+    };
+    auto reduceFunc = [](const int& key, const std::vector<std::string>& values) -> std::string {
+        std::string joined;
+        for (const auto& v : values)
+            joined += v;
+        return joined;
+    };
+
+    mrh::ThreadPool pool(3);
+    for (size_t chunkSize : {0, 1, 7, 5000}) {
+        auto task = std::make_shared<Task>(mapFunc, reduceFunc);
+        task->setNumPartitions(3);
+        task->setReduceChunkSize(chunkSize);
+        auto resMap = std::any_cast<Task::SortedResult>(task->execute(pool));
+        assert(resMap.size() == 1000);
+        for (const auto& kv : resMap)
+            assert(kv.second == "012");
+    }
+    std::cout << "testMapReduceReduceChunks passed." << std::endl;
+}
+
+void testMapReduceSortShuffle() {
+    std::cout << "Running testMapReduceSortShuffle..." << std::endl;
+    auto source = std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>& inputs) -> std::any {
+        std::vector<int> vec(20000);
+        for (int i = 0; i < 20000; ++i)
+            vec[i] = i;
+        return vec;
+    });
+    using Splitter = mrh::RangeSplitter<std::vector<int>>;
+
+    // Signed integral keys take the radix path; values must keep their map-task order.
+    using IntTask = mrh::MapReduceTask<std::vector<int>, long long, int, std::string, Splitter>;
+    auto intMap   = [](const IntTask::Shard& shard) -> std::vector<std::pair<long long, int>> {
+        std::vector<std::pair<long long, int>> out;
+        for (int x : shard)
+            out.emplace_back((x % 2 ? -1LL : 1LL) * (x % 300) * 1000003LL, x);
+        return out;
+    };
+    auto intReduce = [](const long long& key, const std::vector<int>& values) -> std::string {
+        assert(std::is_sorted(values.begin(), values.end()));
+        return std::to_string(values.size()) + ":" + std::to_string(values.front());
+    };
+    // String keys take the comparison sort path.
+    using StringTask = mrh::MapReduceTask<std::vector<int>, std::string, int, int, Splitter>;
+    auto stringMap   = [](const StringTask::Shard& shard) -> std::vector<std::pair<std::string, int>> {
+        std::vector<std::pair<std::string, int>> out;
+        for (int x : shard)
+            out.emplace_back("k" + std::to_string(x % 777), 1);
+        return out;
+    };
+    auto stringReduce = [](const std::string& key, const std::vector<int>& values) -> int {
+        return static_cast<int>(values.size());
+    };
+
+    mrh::ThreadPool pool(3);
+    auto run = [&](auto task, mrh::ShuffleStrategy strategy, bool sorted) {
+        task->dependsOn(source);
+        task->setNumPartitions(5);
+        task->setShuffleStrategy(strategy);
+        task->setSortedOutput(sorted);
+        return task->execute(pool);
+    };
+    using IntSorted = IntTask::SortedResult;
+    auto intHash    = std::any_cast<IntSorted>(run(std::make_shared<IntTask>(intMap, intReduce, 4),
+                                                   mrh::ShuffleStrategy::Hash, true));
+    auto intSort    = std::any_cast<IntSorted>(run(std::make_shared<IntTask>(intMap, intReduce, 4),
+                                                   mrh::ShuffleStrategy::Sort, true));
+    assert(intHash.size() == 300);
+    assert(intSort == intHash);
+
+    auto stringHash = std::any_cast<StringTask::SortedResult>(
+        run(std::make_shared<StringTask>(stringMap, stringReduce, 4), mrh::ShuffleStrategy::Hash, true));
+    auto stringSort = std::any_cast<StringTask::SortedResult>(
+        run(std::make_shared<StringTask>(stringMap, stringReduce, 4), mrh::ShuffleStrategy::Sort, true));
+    assert(stringHash.size() == 777);
+    assert(stringSort == stringHash);
+
+    // Unsorted output of the sort strategy is ordered by key within each partition.
+    auto unsorted = std::any_cast<IntTask::UnsortedResult>(run(std::make_shared<IntTask>(intMap, intReduce, 4),
+                                                               mrh::ShuffleStrategy::Sort, false));
+    assert(unsorted.size() == 300);
+    size_t descents = 0;
+    for (size_t i = 1; i < unsorted.size(); ++i)
+        descents += unsorted[i].first < unsorted[i - 1].first;
+    assert(descents < 5);
+
+#ifdef __SIZEOF_INT128__
+    // Keys wider than 64 bits are not radix sorted, so keys differing only in their high bits stay apart.
+    static_assert(!mrh::detail::IsRadixSortable<__int128>::value, "128-bit keys must not be radix sorted");
+    using Wide = __int128;
+    std::vector<std::pair<Wide, int>> wide;
+    for (int i = 0; i < 8; ++i)
+        wide.emplace_back((Wide(7 - i % 4) << 64) | 5, i);
+    auto wideGroups = mrh::detail::sortGroups(wide);
+    assert(wideGroups.size() == 4);
+    for (size_t i = 0; i < wideGroups.size(); ++i)
+        assert(wideGroups[i].first == ((Wide(4 + i) << 64) | 5) && wideGroups[i].second.size() == 2);
+#endif
+    std::cout << "testMapReduceSortShuffle passed." << std::endl;
+}
+
+void testMapReduceOutOfCore() {
+    std::cout << "Running testMapReduceOutOfCore..." << std::endl;
+    using Task   = mrh::MapReduceTask<std::vector<int>, std::string, int, int, mrh::RangeSplitter<std::vector<int>>>;
+    auto mapFunc = [](const Task::Shard& shard) -> std::vector<std::pair<std::string, int>> {
+        std::vector<std::pair<std::string, int>> out;
+        for (int x : shard)
+            out.emplace_back("key" + std::to_string(x % 5000), 1);
+        return out;
+    };
+    auto reduceFunc = [](const std::string& key, const std::vector<int>& values) -> int {
+        int sum = 0;
+        for (int v : values)
+            sum += v;
+        return sum;
+    };
+    auto input = std::make_shared<mrh::SimpleTask>(
+        [](const std::vector<std::any>&) -> std::any {
+            std::vector<int> data(50000);
+            for (int i = 0; i < 50000; ++i)
+                data[i] = i;
+            return data;
+        },
+        true);
+
+    mrh::ThreadPool pool(3);
+    auto inMemory = std::make_shared<Task>(mapFunc, reduceFunc, 8);
+    inMemory->dependsOn(input);
+    auto expected = std::any_cast<Task::SortedResult>(inMemory->execute(pool));
+    assert(expected.size() == 5000);
+
+    // About 2 MB of intermediate pairs against a 64 KB budget.
+    auto outOfCore = std::make_shared<Task>(mapFunc, reduceFunc, 8);
+    outOfCore->dependsOn(input);
+    outOfCore->setNumPartitions(4);
+    outOfCore->setMemoryBudget(64 * 1024);
+    auto resMap = std::any_cast<Task::SortedResult>(outOfCore->execute(pool));
+    assert(resMap == expected);
+    assert(outOfCore->getSpilledRuns() > 0);
+    for (const auto& kv : resMap)
+        assert(kv.second == 10);
+    std::cout << "testMapReduceOutOfCore passed." << std::endl;
+}
+
+void testProcessExecutor() {
+    std::cout << "Running testProcessExecutor..." << std::endl;
+    if (!mrh::ProcessExecutor::isSupported()) {
+        std::cout << "testProcessExecutor skipped: no worker processes on this platform." << std::endl;
+        return;
+    }
+
+    // Frames larger than the socket buffer arrive whole; closing one end ends the other.
+    auto channels = mrh::SocketChannel::createPair();
+    std::thread sender([&channels]() {
+        channels.first.send(mrh::Frame{mrh::Frame::Type::Reply, 42, std::string(1 << 20, 'x')});
+        channels.first.send(mrh::Frame{mrh::Frame::Type::Error, 7, ""});
+        channels.first.close();
+    });
+    mrh::Frame frame;
+    bool received = channels.second.receive(frame);
+    assert(received);
+    assert(frame.type == mrh::Frame::Type::Reply && frame.id == 42 && frame.payload == std::string(1 << 20, 'x'));
+    received = channels.second.receive(frame);
+    assert(received);
+    assert(frame.type == mrh::Frame::Type::Error && frame.id == 7 && frame.payload.empty());
+    received = channels.second.receive(frame);
+    assert(!received);
+    sender.join();
+
+    // Replies come back in request order, and a worker that dies is replaced.
+    const auto marker = std::filesystem::temp_directory_path() / "mrh_process_executor_test";
+    std::filesystem::remove(marker);
+    auto crashOnce = [marker](const std::string& request) {
+        if (request == "3" && !std::filesystem::exists(marker)) {
+            std::ofstream(marker).put('x');
+            std::_Exit(1);
+        }
+        return request + "!";
+    };
+    mrh::ProcessExecutor executor(3);
+    std::vector<std::string> requests;
+    for (int i = 0; i < 10; ++i)
+        requests.push_back(std::to_string(i));
+    auto replies = executor.run(requests, crashOnce);
+    for (int i = 0; i < 10; ++i)
+        assert(replies[i] == std::to_string(i) + "!");
+    assert(executor.getNumRestarts() == 1);
+
+    // A request that always kills its worker is given up on; handler exceptions are rethrown.
+    std::string message;
+    try {
+        mrh::ProcessExecutor(2, 2).run(requests, [](const std::string& request) -> std::string {
+            if (request == "5")
+                std::_Exit(1);
+            return request;
+        });
+    } catch (const std::runtime_error& e) {
+        message = e.what();
+    }
+    assert(message.find("killed 2 worker processes") != std::string::npos);
+    message.clear();
+    try {
+        executor.run(requests, [](const std::string& request) -> std::string {
+            throw std::runtime_error("bad request " + request);
+        });
+    } catch (const std::runtime_error& e) {
+        message = e.what();
+    }
+    assert(message.find("bad request") == 0);
+
+    // A MapReduce job run in processes matches the in-memory result, despite a crashing map task.
+    using Task   = mrh::MapReduceTask<std::vector<int>, std::string, int, int, mrh::RangeSplitter<std::vector<int>>>;
+    auto mapFunc = [marker](const Task::Shard& shard) -> std::vector<std::pair<std::string, int>> {
+        if (*shard.begin() == 0 && !std::filesystem::exists(marker)) {
+            std::ofstream(marker).put('x');
+            std::_Exit(1);
+        }
+        std::vector<std::pair<std::string, int>> out;
+        for (int x : shard)
+            out.emplace_back("key" + std::to_string(x % 500), 1);
+        return out;
+    };
+    auto reduceFunc = [](const std::string&, const std::vector<int>& values) {
+        return static_cast<int>(values.size());
+    };
+    auto input = std::make_shared<mrh::TypedTask<std::vector<int>>>([](const mrh::TaskInputs&) {
+        std::vector<int> data(20000);
+        for (int i = 0; i < 20000; ++i)
+            data[i] = i;
+        return data;
+    });
+    mrh::ThreadPool pool(2);
+    auto inMemory = std::make_shared<Task>(mapFunc, reduceFunc, 6);
+    inMemory->dependsOn(input);
+    std::ofstream(marker).put('x');
+    const auto expected = std::any_cast<Task::SortedResult>(inMemory->execute(pool));
+    for (auto strategy : {mrh::ShuffleStrategy::Hash, mrh::ShuffleStrategy::Sort}) {
+        std::filesystem::remove(marker);
+        auto inProcesses = std::make_shared<Task>(mapFunc, reduceFunc, 6);
+        auto processes   = std::make_shared<mrh::ProcessExecutor>(3);
+        inProcesses->dependsOn(input);
+        inProcesses->setNumPartitions(4);
+        inProcesses->setShuffleStrategy(strategy);
+        inProcesses->setProcessExecutor(processes);
+        std::any result = inProcesses->execute(pool);
+        assert(std::any_cast<Task::SortedResult>(result) == expected);
+        assert(processes->getNumRestarts() == 1);
+    }
+    std::filesystem::remove(marker);
+    std::cout << "testProcessExecutor passed." << std::endl;
+}
+
+void testMapReduceArena() {
+    std::cout << "Running testMapReduceArena..." << std::endl;
+    std::string text;
+    for (int i = 0; i < 2000; ++i)
+        text += "word" + std::to_string(i % 97) + (i % 2 ? " doc-a\n" : " doc-b\n");
+    auto source = std::make_shared<mrh::SimpleTask>([text](const std::vector<std::any>& inputs) -> std::any {
+        return text;
+    });
+
+    // Keys are pmr strings built in the arena; values are document names interned into it.
+    using Task   = mrh::MapReduceTask<std::string, std::pmr::string, std::string_view, std::string,
+                                      mrh::DelimitedSplitter<std::string>>;
+    auto mapFunc = [](const std::string_view& shard, mrh::MapArena& arena) -> Task::ArenaPairs {
+        Task::ArenaPairs out(arena.getAllocator());
+        mrh::DelimitedSplitter<>::forEachRecord(shard, '\n', [&](std::string_view line) {
+            const size_t space = line.find(' ');
+            out.emplace_back(std::pmr::string(line.substr(0, space), arena.getAllocator()),
+                             arena.intern(std::string(line.substr(space + 1))));
+        });
+        return out;
+    };
+    auto reduceFunc = [](const std::pmr::string& key, const std::vector<std::string_view>& values) -> std::string {
+        std::map<std::string_view, int> counts;
+        for (auto v : values)
+            ++counts[v];
+        std::string joined;
+        for (const auto& kv : counts)
+            joined += std::string(kv.first) + "=" + std::to_string(kv.second) + ";";
+        return joined;
+    };
+
+    mrh::ThreadPool pool(3);
+    for (bool combine : {false, true}) {
+        auto task = std::make_shared<Task>(mapFunc, reduceFunc, 6);
+        task->dependsOn(source);
+        task->setNumPartitions(combine ? 1 : 4);
+        if (combine) {
+            // Keep one value per key and map task to exercise combining arena pairs.
+            task->setCombiner([](const std::pmr::string&, const std::vector<std::string_view>& values) {
+                return values.front();
+            });
+        }
+        auto resMap = std::any_cast<Task::SortedResult>(task->execute(pool));
+        assert(resMap.size() == 97);
+        for (const auto& kv : resMap) {
+            // Result keys own their memory after the arenas are gone.
+            assert(kv.first.get_allocator().resource() == std::pmr::get_default_resource());
+            if (!combine)
+                assert(kv.second.rfind("doc-a=", 0) == 0 && kv.second.find(";doc-b=") != std::string::npos);
+        }
+    }
+
+    // With a memory budget, arena output is copied out before it is spilled.
+    using CountTask = mrh::MapReduceTask<std::string, std::pmr::string, int, int, mrh::DelimitedSplitter<std::string>>;
+    auto countMap   = [](const std::string_view& shard, mrh::MapArena& arena) -> CountTask::ArenaPairs {
+        CountTask::ArenaPairs out(arena.getAllocator());
+        mrh::DelimitedSplitter<>::forEachRecord(shard, '\n', [&](std::string_view line) {
+            out.emplace_back(std::pmr::string(line.substr(0, line.find(' ')), arena.getAllocator()), 1);
+        });
+        return out;
+    };
+    auto countReduce = [](const std::pmr::string& key, const std::vector<int>& values) -> int {
+        return static_cast<int>(values.size());
+    };
+    auto countTask = std::make_shared<CountTask>(countMap, countReduce, 6);
+    countTask->dependsOn(source);
+    countTask->setMemoryBudget(4096);
+    auto counts = std::any_cast<CountTask::SortedResult>(countTask->execute(pool));
+    assert(counts.size() == 97);
+    assert(countTask->getSpilledRuns() > 0);
+    assert(counts["word0"] == 21 && counts["word96"] == 20);
+
+    mrh::MapArena arena;
+    std::string word = "interned";
+    auto first       = arena.intern(word);
+    word[0]          = 'I';
+    assert(first == "interned");
+    auto second = arena.intern("interned");
+    auto empty  = arena.intern("");
+    assert(second.data() == first.data());
+    assert(empty.empty());
+    std::cout << "testMapReduceArena passed." << std::endl;
+}
+
+void testStaticMapReduceTask() {
+    std::cout << "Running testStaticMapReduceTask..." << std::endl;
+    auto source = std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>& inputs) -> std::any {
+        std::vector<int> vec(10000);
+        for (int i = 0; i < 10000; ++i)
+            vec[i] = i;
+        return vec;
+    });
+    using Splitter = mrh::RangeSplitter<std::vector<int>>;
+    auto mapFunc   = [](const Splitter::Shard& shard, auto& emitter) {
+        for (int x : shard)
+            emitter.emit(x % 100, static_cast<long>(x));
+    };
+    auto reduceFunc = [](const int& key, mrh::Range<const long*> values) {
+        long sum = 0;
+        for (long v : values)
+            sum += v;
+        return sum;
+    };
+
+    mrh::ThreadPool pool(3);
+    auto plain = mrh::makeMapReduceTask<std::vector<int>, int, long, Splitter>(mapFunc, reduceFunc, 4);
+    plain->dependsOn(source);
+    plain->setNumPartitions(3);
+    plain->setReduceChunkSize(7);
+    auto resMap = std::any_cast<std::map<int, long>>(plain->execute(pool));
+    assert(resMap.size() == 100);
+    for (const auto& [key, sum] : resMap)
+        assert(sum == 100L * key + 100L * 99 * 50);
+
+    // With a combiner, each map task hands one value per key to the shuffle.
+    std::atomic<size_t> maxGroupSize{0};
+    auto countingReduce = [&maxGroupSize](const int& key, mrh::Range<const long*> values) {
+        size_t expected = maxGroupSize;
+        while (values.size() > expected && !maxGroupSize.compare_exchange_weak(expected, values.size())) {
+        }
+        long sum = 0;
+        for (long v : values)
+            sum += v;
+        return sum;
+    };
+    auto combined = mrh::makeMapReduceTask<std::vector<int>, int, long, Splitter>(
+        mapFunc, countingReduce, [](long lhs, long rhs) { return lhs + rhs; }, 4);
+    combined->dependsOn(source);
+    combined->setSortedOutput(false);
+    auto unsorted = std::any_cast<std::vector<std::pair<int, long>>>(combined->execute(pool));
+    assert(unsorted.size() == 100);
+    assert(maxGroupSize <= 4);
+    assert((std::map<int, long>(unsorted.begin(), unsorted.end()) == resMap));
+
+    // A custom partitioner decides where keys go; an index out of range fails the execution.
+    using Partitioner = std::function<size_t(const int&, size_t)>;
+    using Partitioned = mrh::StaticMapReduceTask<std::vector<int>, int, long, decltype(mapFunc), decltype(reduceFunc),
+                                                 mrh::NoCombiner, Splitter, Partitioner>;
+    auto partitioned = std::make_shared<Partitioned>(mapFunc, reduceFunc, mrh::NoCombiner(), 4);
+    partitioned->dependsOn(source);
+    partitioned->setNumPartitions(4);
+    partitioned->setSortedOutput(false);
+    partitioned->setPartitioner([](const int& key, size_t n) { return static_cast<size_t>(key) % n; });
+    auto byPartition = std::any_cast<std::vector<std::pair<int, long>>>(partitioned->execute(pool));
+    assert(byPartition.size() == 100);
+    for (size_t i = 1; i < byPartition.size(); ++i)
+        assert(byPartition[i - 1].first % 4 <= byPartition[i].first % 4);
+    partitioned->invalidate();
+    partitioned->setPartitioner([](const int&, size_t n) { return n; });
+    bool outOfRange = false;
+    try {
+        partitioned->execute(pool);
+    } catch (const std::out_of_range&) {
+        outOfRange = true;
+    }
+    assert(outOfRange);
+
+    // The emitter converts its arguments, so string keys can be emitted from views.
+    std::string text = "a b a c b a";
+    auto wordCount   = mrh::makeMapReduceTask<std::string, std::string, int, mrh::DelimitedSplitter<std::string>>(
+        [](std::string_view shard, auto& emitter) {
+            mrh::DelimitedSplitter<>::forEachRecord(shard, ' ', [&](std::string_view w) { emitter.emit(w, 1); });
+        },
+        [](const std::string&, mrh::Range<const int*> values) { return static_cast<int>(values.size()); }, 3,
+        mrh::DelimitedSplitter<std::string>(' '));
+    wordCount->dependsOn(std::make_shared<mrh::SimpleTask>([text](const std::vector<std::any>&) -> std::any {
+        return text;
+    }));
+    auto words = std::any_cast<std::map<std::string, int>>(wordCount->execute(pool));
+    assert(words.size() == 3 && words["a"] == 3 && words["b"] == 2 && words["c"] == 1);
+    std::cout << "testStaticMapReduceTask passed." << std::endl;
+}
+
 void testSchedulerIntegration() {
     std::cout << "Running testSchedulerIntegration..." << std::endl;
     auto task1 = std::make_shared<mrh::SimpleTask>(
@@ -127,13 +1170,883 @@ void testSchedulerOneThread() {
     std::cout << "testSchedulerOneThread passed." << std::endl;
 }
 
+void testSchedulerParallelBranches() {
+    std::cout << "Running testSchedulerParallelBranches..." << std::endl;
+    std::atomic<int> running{0};
+    std::atomic<int> maxRunning{0};
+    auto reducer = std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>& inputs) -> std::any {
+        int sum = 0;
+        for (const auto& in : inputs)
+            sum += std::any_cast<int>(in);
+        return sum;
+    });
+    for (int i = 0; i < 16; ++i) {
+        auto loader = std::make_shared<mrh::SimpleTask>(
+            [&running, &maxRunning, i](const std::vector<std::any>& inputs) -> std::any {
+                int now  = ++running;
+                int prev = maxRunning;
+                while (prev < now && !maxRunning.compare_exchange_weak(prev, now)) {
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                --running;
+                return i;
+            });
+        reducer->dependsOn(loader);
+    }
+
+    mrh::Scheduler scheduler(4);
+    const auto start = std::chrono::steady_clock::now();
+    int sum          = std::any_cast<int>(scheduler.execute(reducer));
+    const auto took  = std::chrono::steady_clock::now() - start;
+    assert(sum == 120);
+    assert(maxRunning > 1);
+    assert(took < std::chrono::milliseconds(16 * 10));
+
+    // A non-cached root still yields its result.
+    auto uncached = std::make_shared<mrh::SimpleTask>(
+        [](const std::vector<std::any>& inputs) -> std::any { return std::any_cast<int>(inputs[0]) + 1; }, false);
+    uncached->dependsOn(reducer);
+    std::any uncachedResult = scheduler.execute(uncached);
+    assert(std::any_cast<int>(uncachedResult) == 121);
+    std::cout << "testSchedulerParallelBranches passed." << std::endl;
+}
+
+void testTaskInvalidation() {
+    std::cout << "Running testTaskInvalidation..." << std::endl;
+    // Three sources feed a diamond: sum and product both read all sources, root combines them.
+    std::atomic<int> runs[3]   = {{0}, {0}, {0}};
+    std::atomic<int> values[3] = {{1}, {2}, {3}};
+    std::atomic<int> sumRuns{0}, productRuns{0}, rootRuns{0};
+    std::vector<std::shared_ptr<mrh::SimpleTask>> sources;
+    for (int i = 0; i < 3; ++i) {
+        auto load = [&runs, &values, i](const std::vector<std::any>&) -> std::any {
+            ++runs[i];
+            return values[i].load();
+        };
+        sources.push_back(std::make_shared<mrh::SimpleTask>(load));
+    }
+    auto sum = std::make_shared<mrh::SimpleTask>([&sumRuns](const std::vector<std::any>& inputs) -> std::any {
+        ++sumRuns;
+        int total = 0;
+        for (const auto& in : inputs)
+            total += std::any_cast<int>(in);
+        return total;
+    });
+    auto product = std::make_shared<mrh::SimpleTask>([&productRuns](const std::vector<std::any>& inputs) -> std::any {
+        ++productRuns;
+        int total = 1;
+        for (const auto& in : inputs)
+            total *= std::any_cast<int>(in);
+        return total;
+    });
+    auto root = std::make_shared<mrh::SimpleTask>([&rootRuns](const std::vector<std::any>& inputs) -> std::any {
+        ++rootRuns;
+        return std::to_string(std::any_cast<int>(inputs[0])) + "/" + std::to_string(std::any_cast<int>(inputs[1]));
+    });
+    for (const auto& source : sources) {
+        sum->dependsOn(source);
+        product->dependsOn(source);
+    }
+    root->dependsOn(sum);
+    root->dependsOn(product);
+
+    mrh::Scheduler scheduler(2);
+    auto plan       = mrh::Scheduler::compile(root);
+    std::any result = scheduler.execute(*plan);
+    assert(std::any_cast<std::string>(result) == "6/6");
+    assert(!root->isDirty() && !sources[0]->isDirty());
+
+    // Nothing changed: every task is served from its cache.
+    result = scheduler.execute(*plan);
+    assert(std::any_cast<std::string>(result) == "6/6");
+    assert(rootRuns == 1 && sumRuns == 1 && runs[0] == 1);
+
+    // One source changes: only it and its dependents recompute, each once.
+    values[1] = 5;
+    sources[1]->invalidate();
+    assert(sources[1]->isDirty() && sum->isDirty() && product->isDirty() && root->isDirty());
+    assert(!sources[0]->isDirty() && !sources[2]->isDirty());
+    result = scheduler.execute(*plan);
+    assert(std::any_cast<std::string>(result) == "9/15");
+    assert(runs[0] == 1 && runs[1] == 2 && runs[2] == 1);
+    assert(sumRuns == 2 && productRuns == 2 && rootRuns == 2);
+
+    // Direct execution honours invalidation too.
+    values[2] = 4;
+    sources[2]->invalidate();
+    mrh::ThreadPool pool(1);
+    result = sum->execute(pool);
+    assert(std::any_cast<int>(result) == 10);
+    assert(runs[2] == 2 && !sum->isDirty() && product->isDirty() && root->isDirty());
+    std::cout << "testTaskInvalidation passed." << std::endl;
+}
+
+void testResultStore() {
+    std::cout << "Running testResultStore..." << std::endl;
+    using Task           = mrh::MapReduceTask<std::vector<int>, int, int, int, mrh::RangeSplitter<std::vector<int>>>;
+    const auto directory = std::filesystem::temp_directory_path() / "mrh_result_store_test";
+    std::filesystem::remove_all(directory);
+
+    std::atomic<int> sourceRuns{0}, countRuns{0};
+    // Builds a fresh pipeline, as a restarted process would.
+    auto makePipeline = [&](const std::shared_ptr<mrh::ResultStore>& store, const std::string& sourceKey) {
+        auto source = std::make_shared<mrh::TypedTask<std::vector<int>>>([&sourceRuns](const mrh::TaskInputs&) {
+            ++sourceRuns;
+            std::vector<int> data(1000);
+            for (int i = 0; i < 1000; ++i)
+                data[i] = i;
+            return data;
+        });
+        auto mapFunc = [&countRuns](const Task::Shard& shard) -> std::vector<std::pair<int, int>> {
+            ++countRuns;
+            std::vector<std::pair<int, int>> out;
+            for (int x : shard)
+                out.emplace_back(x % 10, 1);
+            return out;
+        };
+        auto reduceFunc = [](const int&, const std::vector<int>& values) -> int {
+            return static_cast<int>(values.size());
+        };
+        auto count = std::make_shared<Task>(mapFunc, reduceFunc, 1);
+        count->dependsOn(source);
+        source->setCacheKey(sourceKey);
+        count->setCacheKey("count-mod-10");
+        source->setResultStore(store);
+        count->setResultStore(store);
+        return std::make_pair(source, count);
+    };
+
+    mrh::ThreadPool pool(2);
+    Task::SortedResult expected;
+    for (int k = 0; k < 10; ++k)
+        expected[k] = 100;
+    {
+        auto store           = std::make_shared<mrh::ResultStore>(directory, 1 << 20);
+        auto [source, count] = makePipeline(store, "numbers-v1");
+        std::any result      = count->execute(pool);
+        assert(std::any_cast<Task::SortedResult>(result) == expected);
+        assert(sourceRuns == 1 && countRuns == 1);
+        assert(store->getNumEntries() == 2);
+    }
+
+    // Warm restart: a new store and new tasks load both results without running.
+    {
+        auto store           = std::make_shared<mrh::ResultStore>(directory, 1 << 20);
+        auto [source, count] = makePipeline(store, "numbers-v1");
+        assert(store->getNumEntries() == 2);
+        std::any result = count->execute(pool);
+        assert(std::any_cast<Task::SortedResult>(result) == expected);
+        // The dependent was loaded, so the source was not even needed.
+        assert(!source->getTypedResult());
+        assert(sourceRuns == 1 && countRuns == 1);
+
+        // Invalidation skips the store, so the tasks really recompute.
+        source->invalidate();
+        result = count->execute(pool);
+        assert(std::any_cast<Task::SortedResult>(result) == expected);
+        assert(sourceRuns == 2 && countRuns == 2);
+    }
+
+    // A new source key changes the fingerprint of the source and of its dependents.
+    {
+        auto store           = std::make_shared<mrh::ResultStore>(directory, 1 << 20);
+        auto [source, count] = makePipeline(store, "numbers-v2");
+        std::any result      = count->execute(pool);
+        assert(std::any_cast<Task::SortedResult>(result) == expected);
+        assert(sourceRuns == 3 && countRuns == 3);
+        assert(store->getNumEntries() == 4);
+    }
+
+    // A malformed entry is a cache miss: the task recomputes and replaces it.
+    {
+        auto store           = std::make_shared<mrh::ResultStore>(directory, 1 << 20);
+        auto [source, count] = makePipeline(store, "numbers-v2");
+        std::ostringstream corrupt;
+        mrh::Serializer<std::string>::write(corrupt, typeid(Task::UnsortedResult).name());
+        mrh::detail::writeVarint(corrupt, uint64_t(1) << 40);
+        store->store(*count->getFingerprint(), corrupt.str());
+        std::any result = count->execute(pool);
+        assert(std::any_cast<Task::SortedResult>(result) == expected);
+        assert(sourceRuns == 3 && countRuns == 4);
+    }
+
+    // Without a key on every dependency there is no fingerprint and nothing is stored.
+    {
+        auto store           = std::make_shared<mrh::ResultStore>(directory, 1 << 20);
+        auto [source, count] = makePipeline(store, "numbers-v3");
+        auto unkeyed         = std::make_shared<mrh::TypedTask<int>>([](const mrh::TaskInputs&) { return 1; });
+        unkeyed->setResultStore(store);
+        count->dependsOn(unkeyed);
+        assert(!unkeyed->getFingerprint() && !count->getFingerprint() && source->getFingerprint());
+    }
+
+    // Fingerprints of deep chains and of layered diamonds are computed without recursion or repeated work.
+    {
+        auto makeKeyed = [](const std::string& key) {
+            auto task = std::make_shared<mrh::TypedTask<int>>([](const mrh::TaskInputs&) { return 0; });
+            task->setCacheKey(key);
+            return task;
+        };
+        std::vector<std::shared_ptr<mrh::TypedTask<int>>> chain{makeKeyed("chain-0")};
+        for (int i = 1; i < 100000; ++i) {
+            chain.push_back(makeKeyed("chain-" + std::to_string(i)));
+            chain.back()->dependsOn(chain[i - 1]);
+        }
+        const std::optional<uint64_t> chainFingerprint = chain.back()->getFingerprint();
+        assert(chainFingerprint && chain.back()->getFingerprint() == chainFingerprint);
+        chain.front()->setCacheKey("chain-0-v2");
+        const std::optional<uint64_t> changedFingerprint = chain.back()->getFingerprint();
+        assert(changedFingerprint && changedFingerprint != chainFingerprint);
+        // Released from the back, so no task's destructor has to release the rest of the chain recursively.
+        while (!chain.empty())
+            chain.pop_back();
+
+        // 64 layers of two tasks, each depending on both tasks of the layer below: 2^64 paths.
+        std::vector<std::shared_ptr<mrh::TypedTask<int>>> layer{makeKeyed("left-0"), makeKeyed("right-0")};
+        for (int i = 1; i <= 64; ++i) {
+            std::vector<std::shared_ptr<mrh::TypedTask<int>>> next{makeKeyed("left-" + std::to_string(i)),
+                                                                   makeKeyed("right-" + std::to_string(i))};
+            for (const auto& task : next) {
+                task->dependsOn(layer[0]);
+                task->dependsOn(layer[1]);
+            }
+            layer = std::move(next);
+        }
+        const std::optional<uint64_t> left = layer[0]->getFingerprint(), right = layer[1]->getFingerprint();
+        assert(left && right && left != right);
+    }
+
+    // A small bound evicts the least recently used entries.
+    {
+        std::filesystem::remove_all(directory);
+        auto store = std::make_shared<mrh::ResultStore>(directory, 1000);
+        store->store(1, std::string(400, 'a'));
+        store->store(2, std::string(400, 'b'));
+        std::string bytes;
+        const bool loaded = store->load(1, bytes);
+        assert(loaded && bytes == std::string(400, 'a'));
+        // Recency is tracked in memory, so this holds however coarse the file times are.
+        store->store(3, std::string(400, 'c'));
+        const bool kept    = store->load(1, bytes);
+        const bool evicted = !store->load(2, bytes);
+        assert(kept && evicted && store->getNumEntries() == 2);
+        store->store(4, std::string(2000, 'd'));
+        const bool tooLarge = !store->load(4, bytes);
+        assert(tooLarge);
+    }
+
+    // Reopening orders the entries found by their modification times.
+    {
+        const auto now = std::filesystem::file_time_type::clock::now();
+        std::filesystem::last_write_time(directory / "0000000000000001.result", now - std::chrono::hours(1));
+        std::filesystem::last_write_time(directory / "0000000000000003.result", now);
+        auto bounded = std::make_shared<mrh::ResultStore>(directory, 600);
+        assert(bounded->getSize() <= 600 && bounded->getNumEntries() == 1);
+        std::string bytes;
+        const bool kept    = bounded->load(3, bytes);
+        const bool evicted = !bounded->load(1, bytes);
+        assert(kept && evicted);
+    }
+    std::filesystem::remove_all(directory);
+    std::cout << "testResultStore passed." << std::endl;
+}
+
+void testTracing() {
+    std::cout << "Running testTracing..." << std::endl;
+    using Task  = mrh::MapReduceTask<std::vector<int>, int, int, int, mrh::RangeSplitter<std::vector<int>>>;
+    auto source = std::make_shared<mrh::TypedTask<std::vector<int>>>([](const mrh::TaskInputs&) {
+        std::vector<int> data(1000);
+        for (int i = 0; i < 1000; ++i)
+            data[i] = i;
+        return data;
+    });
+    auto count = std::make_shared<Task>(
+        [](const Task::Shard& shard) {
+            std::vector<std::pair<int, int>> out;
+            for (int x : shard)
+                out.emplace_back(x % 7, 1);
+            return out;
+        },
+        [](const int&, const std::vector<int>& values) { return static_cast<int>(values.size()); }, 4);
+    count->dependsOn(source);
+
+    mrh::Tracer::clear();
+    mrh::Scheduler scheduler(2);
+    auto plan       = mrh::Scheduler::compile(count);
+    std::any result = scheduler.execute(*plan);
+    assert(std::any_cast<Task::SortedResult>(result).size() == 7);
+    mrh::Scheduler::Stats stats = scheduler.getStats();
+    assert(stats.executions == 1 && stats.tasksRun == 2 && stats.tasksSkipped == 0);
+
+    // The second execution is served from the caches.
+    scheduler.execute(*plan);
+    stats = scheduler.getStats();
+    assert(stats.executions == 2 && stats.tasksRun == 2 && stats.tasksSkipped == 2);
+    scheduler.resetStats();
+    assert(scheduler.getStats().executions == 0 && scheduler.getStats().taskTime == 0);
+
+    std::ostringstream trace;
+    mrh::Tracer::writeChromeTrace(trace);
+    assert(trace.str().find("\"traceEvents\":[") != std::string::npos);
+    if constexpr (mrh::Tracer::Enabled) {
+        assert(mrh::Tracer::getNumEvents() > 0);
+        for (const char* name : {"\"MapReduce::map\"", "\"MapReduce::shuffle\"", "\"MapReduce::reduce\"",
+                                 "\"Task::run\"", "\"pending\""})
+            assert(trace.str().find(name) != std::string::npos);
+        mrh::Tracer::clear();
+        assert(mrh::Tracer::getNumEvents() == 0);
+
+        // Every pop of a SharedQueue pool is sampled, so the queue is seen draining to zero.
+        {
+            mrh::ThreadPool pool(2, mrh::ThreadPool::Mode::SharedQueue);
+            std::vector<std::future<int>> futures;
+            for (int i = 0; i < 100; ++i)
+                futures.push_back(pool.enqueue([i]() { return i; }));
+            for (auto& future : futures)
+                future.get();
+        }
+        std::ostringstream sharedTrace;
+        mrh::Tracer::writeChromeTrace(sharedTrace);
+        mrh::Tracer::clear();
+        // Every event is on its own line; the last sample is the one with the latest timestamp.
+        std::istringstream lines(sharedTrace.str());
+        std::string line, lastTimestamp;
+        int64_t lastPending = -1;
+        while (std::getline(lines, line)) {
+            if (line.find("\"name\":\"pending\"") == std::string::npos)
+                continue;
+            const size_t ts       = line.find("\"ts\":") + 5;
+            const size_t value    = line.find("\"value\":") + 8;
+            std::string timestamp = line.substr(ts, line.find(',', ts) - ts);
+            // Zero-padded, so the fixed-point microseconds compare as strings.
+            timestamp.insert(0, 24 - std::min<size_t>(24, timestamp.size()), '0');
+            if (timestamp >= lastTimestamp) {
+                lastTimestamp = timestamp;
+                lastPending   = std::stoll(line.substr(value));
+            }
+        }
+        assert(lastPending == 0);
+
+        // Buffers of exited threads are reused, so short-lived threads do not add a buffer each.
+        auto countThreads = [] {
+            std::ostringstream out;
+            mrh::Tracer::writeChromeTrace(out);
+            const std::string json = out.str();
+            size_t count = 0, pos = 0;
+            while ((pos = json.find("thread_name", pos)) != std::string::npos) {
+                ++count;
+                ++pos;
+            }
+            return count;
+        };
+        const size_t threadsBefore = countThreads();
+        for (int i = 0; i < 50; ++i)
+            std::thread([] { MRH_TRACE_INSTANT("shortLived", "test"); }).join();
+        const size_t threadsAfter = countThreads();
+        assert(threadsAfter <= threadsBefore + 1 && mrh::Tracer::getNumEvents() == 50);
+        mrh::Tracer::clear();
+    } else {
+        assert(mrh::Tracer::getNumEvents() == 0);
+    }
+    std::cout << "testTracing passed." << std::endl;
+}
+
+void testSchedulerPriority() {
+    std::cout << "Running testSchedulerPriority..." << std::endl;
+    std::mutex mutex;
+    std::vector<std::string> order;
+    auto makeTask = [&mutex, &order](const std::string& name) {
+        return std::make_shared<mrh::SimpleTask>([&mutex, &order, name](const std::vector<std::any>&) -> std::any {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(name);
+            return 0;
+        });
+    };
+    // A chain c1 -> ... -> c4 and four independent leaves all feed the root.
+    auto root   = makeTask("root");
+    auto source = makeTask("c1");
+    std::shared_ptr<mrh::Task> chain = source;
+    for (const char* name : {"c2", "c3", "c4"}) {
+        auto next = makeTask(name);
+        next->dependsOn(chain);
+        chain = next;
+    }
+    root->dependsOn(chain);
+    std::vector<std::shared_ptr<mrh::SimpleTask>> leaves;
+    for (const char* name : {"l0", "l1", "l2", "l3"}) {
+        leaves.push_back(makeTask(name));
+        root->dependsOn(leaves.back());
+    }
+
+    // With one worker running the plan itself, the dispatch order is the execution order.
+    mrh::Scheduler scheduler(1);
+    auto plan   = mrh::Scheduler::compile(root);
+    auto runAll = [&] {
+        order.clear();
+        source->invalidate();
+        for (const auto& leaf : leaves)
+            leaf->invalidate();
+        scheduler.submit(plan).get();
+        return order;
+    };
+
+    // The chain is the longest path, so it starts before the leaves.
+    assert(scheduler.getPolicy() == mrh::Scheduler::Policy::CriticalPath);
+    std::vector<std::string> expected = {"c1", "c2", "c3", "c4", "l0", "l1", "l2", "l3", "root"};
+    std::vector<std::string> actual   = runAll();
+    assert(std::equal(expected.begin(), expected.begin() + 3, actual.begin()) && actual.back() == "root");
+    assert(source->getLastRuntime() > 0 && root->getLastRuntime() > 0);
+
+    // A user priority overrides the path length.
+    leaves[2]->setPriority(1);
+    actual = runAll();
+    assert(actual.front() == "l2" && actual[1] == "c1" && actual.back() == "root");
+
+    // First in, first out: the leaves became ready before the chain could advance.
+    leaves[2]->setPriority(0);
+    scheduler.setPolicy(mrh::Scheduler::Policy::Fifo);
+    actual = runAll();
+    assert(actual.size() == expected.size() && actual.front() != "c1" && actual.back() == "root");
+    std::cout << "testSchedulerPriority passed." << std::endl;
+}
+
+void testCancellation() {
+    std::cout << "Running testCancellation..." << std::endl;
+    using namespace std::chrono_literals;
+    assert(!mrh::CancellationToken().isCancelled() && !mrh::CancellationToken::current().canBeCancelled());
+    auto parent = mrh::CancellationToken::create();
+    auto child  = parent.child();
+    child.cancel();
+    assert(child.isCancelled() && !parent.isCancelled());
+    auto grandchild = parent.child().child();
+    parent.cancel();
+    assert(grandchild.isCancelled());
+    auto timed = mrh::CancellationToken::withTimeout(5ms);
+    assert(!timed.isCancelled() && timed.child().getDeadline() == timed.getDeadline());
+    std::this_thread::sleep_for(10ms);
+    assert(timed.isCancelled());
+
+    // Forty 20 ms tasks on two threads take 400 ms; an abandoned job stops within a task or two.
+    std::atomic<int> started{0};
+    auto root = std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>&) -> std::any { return 0; });
+    std::vector<std::shared_ptr<mrh::SimpleTask>> leaves;
+    for (int i = 0; i < 40; ++i) {
+        leaves.push_back(std::make_shared<mrh::SimpleTask>([&started](const std::vector<std::any>&) -> std::any {
+            ++started;
+            std::this_thread::sleep_for(20ms);
+            return 0;
+        }));
+        root->dependsOn(leaves.back());
+    }
+    auto isCancelled = [](std::future<std::any>& fut) {
+        try {
+            fut.get();
+        } catch (const mrh::OperationCancelled&) {
+            return true;
+        }
+        return false;
+    };
+    mrh::Scheduler scheduler(2);
+    auto plan  = mrh::Scheduler::compile(root);
+    auto token = mrh::CancellationToken::create();
+    auto start = std::chrono::steady_clock::now();
+    auto fut   = scheduler.submit(plan, token);
+    while (started == 0)
+        std::this_thread::yield();
+    token.cancel();
+    bool wasCancelled = isCancelled(fut);
+    assert(wasCancelled);
+    assert(std::chrono::steady_clock::now() - start < 200ms && started < 10);
+    assert(root->isDirty());
+
+    // A deadline cancels the same way, and the graph can be resumed later with its finished tasks cached.
+    started      = 0;
+    start        = std::chrono::steady_clock::now();
+    fut          = scheduler.submit(plan, mrh::CancellationToken::withTimeout(50ms));
+    wasCancelled = isCancelled(fut);
+    assert(wasCancelled);
+    assert(std::chrono::steady_clock::now() - start < 250ms && started < 20);
+    scheduler.execute(*plan);
+    assert(!root->isDirty());
+
+    // First failure cancels siblings.
+    started   = 0;
+    auto fail = std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>&) -> std::any {
+        throw std::runtime_error("failed");
+    });
+    auto failing = std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>&) -> std::any { return 0; });
+    failing->dependsOn(fail);
+    for (const auto& leaf : leaves) {
+        leaf->invalidate();
+        failing->dependsOn(leaf);
+    }
+    scheduler.setCancelOnFailure(true);
+    scheduler.setPolicy(mrh::Scheduler::Policy::Fifo);
+    bool threw = false;
+    try {
+        scheduler.execute(failing);
+    } catch (const std::runtime_error& e) {
+        threw = std::string(e.what()) == "failed";
+    }
+    assert(threw && started < 40);
+
+    // A direct execution under a cancelled token does not start the task.
+    auto cancelled = mrh::CancellationToken::create();
+    cancelled.cancel();
+    mrh::ThreadPool pool(1);
+    threw = false;
+    try {
+        mrh::CancellationScope scope(cancelled);
+        root->invalidate();
+        root->execute(pool);
+    } catch (const mrh::OperationCancelled&) {
+        threw = true;
+    }
+    assert(threw && root->isDirty());
+
+    // Cancelling from inside a map task skips the map tasks that have not started.
+    using Task   = mrh::MapReduceTask<std::vector<int>, int, int, int, mrh::RangeSplitter<std::vector<int>>>;
+    auto mapping = mrh::CancellationToken::create();
+    std::atomic<int> mapped{0};
+    auto input = std::make_shared<mrh::TypedTask<std::vector<int>>>(
+        [](const mrh::TaskInputs&) { return std::vector<int>(1600, 1); });
+    auto count = std::make_shared<Task>(
+        [&mapping, &mapped](const Task::Shard& shard) {
+            ++mapped;
+            mapping.cancel();
+            return std::vector<std::pair<int, int>>{{0, static_cast<int>(shard.size())}};
+        },
+        [](const int&, const std::vector<int>& values) { return static_cast<int>(values.size()); }, 16);
+    count->dependsOn(input);
+    threw = false;
+    try {
+        mrh::CancellationScope scope(mapping);
+        count->execute(pool);
+    } catch (const mrh::OperationCancelled&) {
+        threw = true;
+    }
+    assert(threw && mapped < 16 && count->isDirty());
+    std::cout << "testCancellation passed." << std::endl;
+}
+
+void testExecutionPlan() {
+    std::cout << "Running testExecutionPlan..." << std::endl;
+    std::atomic<int> runs{0};
+    auto source = std::make_shared<mrh::SimpleTask>(
+        [&runs](const std::vector<std::any>& inputs) -> std::any { return ++runs, 1; }, false);
+    auto left = std::make_shared<mrh::SimpleTask>(
+        [](const std::vector<std::any>& inputs) -> std::any { return std::any_cast<int>(inputs[0]) * 2; }, false);
+    auto right = std::make_shared<mrh::SimpleTask>(
+        [](const std::vector<std::any>& inputs) -> std::any { return std::any_cast<int>(inputs[0]) * 3; }, false);
+    auto join = std::make_shared<mrh::SimpleTask>(
+        [](const std::vector<std::any>& inputs) -> std::any {
+            return std::any_cast<int>(inputs[0]) + std::any_cast<int>(inputs[1]);
+        },
+        false);
+    left->dependsOn(source);
+    right->dependsOn(source);
+    join->dependsOn(left);
+    join->dependsOn(right);
+
+    auto plan = mrh::Scheduler::compile(join);
+    assert(plan->size() == 4);
+    assert(plan->getTask(plan->getRootIndex()) == join);
+    assert(plan->getSources().size() == 1);
+    assert(plan->getTask(plan->getSources()[0]) == source);
+    assert(plan->getDependents(plan->getSources()[0]).size() == 2);
+
+    mrh::Scheduler scheduler(2);
+    for (int i = 0; i < 10; ++i) {
+        std::any result = scheduler.execute(*plan);
+        assert(std::any_cast<int>(result) == 5);
+    }
+    std::any submitted = scheduler.submit(plan).get();
+    assert(std::any_cast<int>(submitted) == 5);
+    assert(runs > 0);
+
+    // Deep chains compile iteratively.
+    auto chainRoot = std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>&) -> std::any { return 0; });
+    for (int i = 0; i < 10000; ++i) {
+        auto next = std::make_shared<mrh::SimpleTask>(
+            [](const std::vector<std::any>& inputs) -> std::any { return std::any_cast<int>(inputs[0]) + 1; });
+        next->dependsOn(chainRoot);
+        chainRoot = next;
+    }
+    std::any chainResult = scheduler.execute(*mrh::Scheduler::compile(chainRoot));
+    assert(std::any_cast<int>(chainResult) == 10000);
+
+    // Cycles are rejected at compile time.
+    auto a = std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>&) -> std::any { return 0; });
+    auto b = std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>&) -> std::any { return 0; });
+    b->dependsOn(a);
+    a->dependsOn(b);
+    bool thrown = false;
+    try {
+        mrh::Scheduler::compile(b);
+    } catch (const std::logic_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::cout << "testExecutionPlan passed." << std::endl;
+}
+
+struct CopyCounted {
+    static std::atomic<int> copies;
+    std::vector<int> data;
+
+    CopyCounted() = default;
+    CopyCounted(const CopyCounted& other) : data(other.data) { ++copies; }
+    CopyCounted(CopyCounted&&) = default;
+    CopyCounted& operator=(const CopyCounted& other) {
+        data = other.data;
+        ++copies;
+        return *this;
+    }
+    CopyCounted& operator=(CopyCounted&&) = default;
+};
+
+std::atomic<int> CopyCounted::copies{0};
+
+void testTypedTaskResults() {
+    std::cout << "Running testTypedTaskResults..." << std::endl;
+    auto source = std::make_shared<mrh::TypedTask<CopyCounted>>([](const mrh::TaskInputs& inputs) {
+        CopyCounted value;
+        value.data.assign(1000, 1);
+        return value;
+    });
+    auto sum = std::make_shared<mrh::TypedTask<long>>([](const mrh::TaskInputs& inputs) {
+        mrh::Result<CopyCounted> in = inputs.get<CopyCounted>(0);
+        long total                  = 0;
+        for (int v : in->data)
+            total += v;
+        return total;
+    });
+    sum->dependsOn(source);
+
+    using Task   = mrh::MapReduceTask<CopyCounted, int, int, int>;
+    auto mapFunc = [](const CopyCounted& input) -> std::vector<std::pair<int, int>> {
+        return {{0, static_cast<int>(input.data.size())}};
+    };
+    auto reduceFunc = [](const int& key, const std::vector<int>& values) -> int { return values[0]; };
+    auto mapReduce  = std::make_shared<Task>(mapFunc, reduceFunc);
+    mapReduce->dependsOn(source);
+
+    mrh::Scheduler scheduler(2);
+    CopyCounted::copies = 0;
+    std::any total = scheduler.execute(sum);
+    assert(std::any_cast<long>(total) == 1000);
+    std::any sizes = scheduler.execute(mapReduce);
+    assert(std::any_cast<Task::SortedResult>(sizes).at(0) == 1000);
+    mrh::ThreadPool pool(1);
+    auto executed = source->executeTyped(pool);
+    assert(executed.share() == source->getTypedResult().share());
+    auto again = source->executeTyped(pool);
+    assert(&again.get() == &source->getTypedResult().get());
+    assert(CopyCounted::copies == 0);
+
+    // Untyped consumers still receive a std::any holding the value.
+    auto legacy = std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>& inputs) -> std::any {
+        return std::any_cast<const CopyCounted&>(inputs[0]).data.size();
+    });
+    legacy->dependsOn(source);
+    std::any legacyResult = scheduler.execute(legacy);
+    assert(std::any_cast<size_t>(legacyResult) == 1000);
+    assert(CopyCounted::copies == 1);
+
+    // Untyped dependencies are moved into a Result.
+    auto untyped = std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>&) -> std::any { return 41; });
+    auto typed   = std::make_shared<mrh::TypedTask<int>>(
+        [](const mrh::TaskInputs& inputs) { return inputs.get<int>(0).get() + 1; });
+    typed->dependsOn(untyped);
+    std::any typedResult = scheduler.execute(typed);
+    assert(std::any_cast<int>(typedResult) == 42);
+    std::cout << "testTypedTaskResults passed." << std::endl;
+}
+
+void testTaskAsync() {
+    std::cout << "Running testTaskAsync..." << std::endl;
+    mrh::ThreadPool pool(2);
+
+    // Executions that arrive while the task runs are queued instead of blocking.
+    std::promise<void> started, gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    std::atomic<int> runs{0};
+    auto slow = std::make_shared<mrh::SimpleTask>([&](const std::vector<std::any>&) -> std::any {
+        ++runs;
+        started.set_value();
+        opened.wait();
+        return 7;
+    });
+    auto running = std::async(std::launch::async, [&]() { return std::any_cast<int>(slow->execute(pool)); });
+    started.get_future().wait();
+    std::atomic<int> completed{0};
+    for (int i = 0; i < 3; ++i) {
+        slow->executeAsync(pool, [&completed](std::any result, std::exception_ptr error) {
+            assert(!error && std::any_cast<int>(result) == 7);
+            ++completed;
+        });
+    }
+    assert(completed == 0);
+    gate.set_value();
+    const int value = running.get();
+    assert(value == 7);
+    assert(completed == 3);
+    assert(runs == 1);
+
+    // Cached results complete right away, exceptions reach the completion.
+    bool cached = false;
+    slow->executeAsync(pool,
+                       [&cached](std::any result, std::exception_ptr) { cached = std::any_cast<int>(result) == 7; });
+    assert(cached);
+    auto failing = std::make_shared<mrh::SimpleTask>(
+        [](const std::vector<std::any>&) -> std::any { throw std::runtime_error("failed"); });
+    bool failed = false;
+    failing->executeAsync(pool, [&failed](std::any, std::exception_ptr error) { failed = error != nullptr; });
+    assert(failed && failing->isDirty());
+
+    // A held group waits for the release, which may report an error.
+    mrh::TaskGroup group(pool);
+    std::thread releaser;
+    group.run([&group, &releaser]() {
+        group.hold();
+        releaser = std::thread([&group]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            group.release(std::make_exception_ptr(std::runtime_error("released")));
+        });
+    });
+    bool thrown = false;
+    try {
+        group.wait();
+    } catch (const std::runtime_error& e) {
+        thrown = std::string(e.what()) == "released";
+    }
+    releaser.join();
+    assert(thrown);
+    std::cout << "testTaskAsync passed." << std::endl;
+}
+
+#if MRHELPER_COROUTINES
+
+mrh::Async<int> addLater(mrh::Result<int> value, int offset) {
+    co_return value.get() + offset;
+}
+
+mrh::Async<> checkPositive(int value) {
+    if (value <= 0)
+        throw std::invalid_argument("not positive");
+    co_return;
+}
+
+void testCoroutineTask() {
+    std::cout << "Running testCoroutineTask..." << std::endl;
+    mrh::ThreadPool pool(2);
+
+    // Many coroutines wait for a running source without holding a pool thread.
+    std::promise<void> started, gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    auto source = std::make_shared<mrh::SimpleTask>([&](const std::vector<std::any>&) -> std::any {
+        started.set_value();
+        opened.wait();
+        return 7;
+    });
+    pool.post([&pool, source]() { source->execute(pool); });
+    started.get_future().wait();
+
+    constexpr int count = 1000;
+    std::vector<std::shared_ptr<mrh::CoroutineTask<int>>> tasks;
+    for (int i = 0; i < count; ++i) {
+        auto task = std::make_shared<mrh::CoroutineTask<int>>([i](mrh::AsyncInputs inputs) -> mrh::Async<int> {
+            mrh::Result<int> value = co_await inputs.get<int>(0);
+            co_await checkPositive(value.get());
+            co_return co_await addLater(value, i);
+        });
+        task->dependsOn(source);
+        tasks.push_back(task);
+    }
+    std::atomic<int> completed{0}, sum{0};
+    std::promise<void> allDone;
+    for (auto& task : tasks) {
+        task->executeAsync(pool, [&](std::any result, std::exception_ptr error) {
+            assert(!error);
+            sum += std::any_cast<int>(result);
+            if (++completed == count)
+                allDone.set_value();
+        });
+    }
+    // Every execution is suspended, and the second thread is still free.
+    assert(completed == 0);
+    const int direct = pool.enqueue([]() { return 1; }).get();
+    assert(direct == 1);
+    gate.set_value();
+    allDone.get_future().wait();
+    assert(sum == count * 7 + count * (count - 1) / 2);
+
+    // Inside a scheduled graph, with blocking execution and error propagation.
+    mrh::Scheduler scheduler(1);
+    auto consumer = std::make_shared<mrh::TypedTask<int>>(
+        [](const mrh::TaskInputs& inputs) { return inputs.get<int>(0).get() * 2; });
+    consumer->dependsOn(tasks[3]);
+    tasks[3]->invalidate();
+    std::any result = scheduler.execute(consumer);
+    assert(std::any_cast<int>(result) == 20);
+    tasks[5]->invalidate();
+    result = tasks[5]->execute(pool);
+    assert(std::any_cast<int>(result) == 12);
+
+    auto negative = std::make_shared<mrh::SimpleTask>([](const std::vector<std::any>&) -> std::any { return -1; });
+    auto checked  = std::make_shared<mrh::CoroutineTask<int>>([](mrh::AsyncInputs inputs) -> mrh::Async<int> {
+        std::any value = co_await inputs.getAny(0);
+        co_await checkPositive(std::any_cast<int>(value));
+        co_return 0;
+    });
+    checked->dependsOn(negative);
+    bool thrown = false;
+    try {
+        scheduler.execute(checked);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown && checked->isDirty());
+    std::cout << "testCoroutineTask passed." << std::endl;
+}
+
+#endif
+
 int main() {
     std::cout << "Running MRHelper tests..." << std::endl;
+    testThreadPoolModes();
+    testThreadPoolSubmission();
+    testThreadPoolTopology();
+    testThreadPoolElastic();
+    testTaskGroup();
     testSimpleTaskCaching();
     testSimpleTaskNoCaching();
     testMapReduceTask();
+    testMapReduceRangeSplitter();
+    testMapReduceDelimitedSplitter();
+    testMappedFileSource();
+    testMapReduceCombiner();
+    testMapReducePartitionedShuffle();
+    testMapReduceReduceChunks();
+    testMapReduceSortShuffle();
+    testMapReduceOutOfCore();
+    testProcessExecutor();
+    testMapReduceArena();
+    testStaticMapReduceTask();
     testSchedulerIntegration();
     testSchedulerOneThread();
+    testSchedulerParallelBranches();
+    testSchedulerPriority();
+    testCancellation();
+    testExecutionPlan();
+    testTaskInvalidation();
+    testResultStore();
+    testTracing();
+    testTypedTaskResults();
+    testTaskAsync();
+#if MRHELPER_COROUTINES
+    testCoroutineTask();
+#endif
     std::cout << "All tests passed." << std::endl;
     return 0;
 }